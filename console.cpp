@@ -0,0 +1,190 @@
+/**  
+* @file console.cpp  
+* @brief Character cell console over a ILI9341 display,
+* only the cells that changed are sent to the display
+*  
+* @author Marcelo H Moraes 
+* 
+* @date 10/18/2026
+*
+* Copyright (c) 2021, Marcelo H Moraes
+* SPDX-License-Identifier: Apache-2.0
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+*
+* You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied.
+*
+* See the License for the specific language governing permissions and limitations under the License.
+*/ 
+
+#include <stdarg.h>
+#include <stdio.h>
+#include "console.h"
+
+/* --- Public methods --- */
+
+ILI9341Console::ILI9341Console(ILI9341 &display, lcdConsoleCell_t *cells,
+		uint8_t columns, uint8_t rows, font_t *font, int16_t x, int16_t y) :
+		_display(display), _cells(cells), _font(font),
+		_columns(columns), _rows(rows), _x(x), _y(y) {
+	clear(_bg);
+	// Screen content is unknown, first flush draws everything
+	invalidate();
+}
+
+void ILI9341Console::clear(uint16_t bg) {
+	LCD_LOCK(_display);
+	for (uint8_t row = 0; row < _rows; row++) {
+		for (uint8_t column = 0; column < _columns; column++) {
+			setCell(column, row, ' ', _fg, bg);
+		}
+	}
+	_column = 0;
+	_row = 0;
+}
+
+void ILI9341Console::invalidate(void) {
+	LCD_LOCK(_display);
+	uint16_t cells = _columns * _rows;
+	for (uint16_t i = 0; i < cells; i++) {
+		_cells[i].c |= LCD_CONSOLE_DIRTY;
+	}
+}
+
+void ILI9341Console::setTextColor(uint16_t fg, uint16_t bg) {
+	_fg = fg;
+	_bg = bg;
+}
+
+void ILI9341Console::setCursor(uint8_t column, uint8_t row) {
+	_column = column < _columns ? column : _columns - 1;
+	_row = row < _rows ? row : _rows - 1;
+}
+
+void ILI9341Console::setCell(uint8_t column, uint8_t row, char c, uint16_t fg, uint16_t bg) {
+	LCD_LOCK(_display);
+	if (column >= _columns || row >= _rows)
+		return;
+
+	lcdConsoleCell_t *cell = &_cells[row * _columns + column];
+	uint8_t value = c & ~LCD_CONSOLE_DIRTY;
+
+	// Same content, nothing to draw
+	if ((cell->c & ~LCD_CONSOLE_DIRTY) == value && cell->fg == fg && cell->bg == bg)
+		return;
+
+	cell->c = value | LCD_CONSOLE_DIRTY;
+	cell->fg = fg;
+	cell->bg = bg;
+}
+
+void ILI9341Console::putChar(char c) {
+	if (c == '\n') {
+		newLine();
+	} else if (c == '\r') {
+		_column = 0;
+	} else {
+		if (_column >= _columns)
+			newLine();
+		setCell(_column, _row, c, _fg, _bg);
+		_column++;
+	}
+}
+
+void ILI9341Console::print(const char *text) {
+	LCD_LOCK(_display);
+	while (*text) {
+		putChar(*text++);
+	}
+}
+
+void ILI9341Console::printf(const char *fmt, ...) {
+	char buf[128];
+	va_list lst;
+	va_start(lst, fmt);
+	vsnprintf(buf, sizeof(buf), fmt, lst);
+	va_end(lst);
+	print(buf);
+}
+
+void ILI9341Console::scroll(void) {
+	LCD_LOCK(_display);
+	for (uint8_t row = 0; row < _rows; row++) {
+		for (uint8_t column = 0; column < _columns; column++) {
+			if (row + 1 < _rows) {
+				const lcdConsoleCell_t *below = &_cells[(row + 1) * _columns + column];
+				setCell(column, row, below->c, below->fg, below->bg);
+			} else {
+				setCell(column, row, ' ', _fg, _bg);
+			}
+		}
+	}
+}
+
+uint16_t ILI9341Console::flush(void) {
+	LCD_LOCK(_display);
+	uint16_t drawn = 0;
+
+	for (uint8_t row = 0; row < _rows; row++) {
+		const lcdConsoleCell_t *line = &_cells[row * _columns];
+		uint8_t column = 0;
+
+		while (column < _columns) {
+			if (!(line[column].c & LCD_CONSOLE_DIRTY)) {
+				column++;
+				continue;
+			}
+			// Adjacent changed cells are drawn as one run
+			uint8_t first = column;
+			while (column < _columns && (line[column].c & LCD_CONSOLE_DIRTY))
+				column++;
+			drawRun(row, first, column - 1);
+			drawn += column - first;
+		}
+	}
+	return drawn;
+}
+
+/* --- Protected methods --- */
+
+void ILI9341Console::newLine(void) {
+	_column = 0;
+	if (_row + 1 < _rows) {
+		_row++;
+	} else {
+		scroll();
+	}
+}
+
+void ILI9341Console::drawRun(uint8_t row, uint8_t first, uint8_t last) {
+	lcdConsoleCell_t *line = &_cells[row * _columns];
+	const lcdClip_t &clip = _display.Clip;
+	int16_t left = clip.originX + _x + first * _font->Width;
+	int16_t top = clip.originY + _y + row * _font->Height;
+	int16_t x0 = left;
+	int16_t y0 = top;
+	int16_t x1 = left + (last - first + 1) * _font->Width - 1;
+	int16_t y1 = top + _font->Height - 1;
+
+	for (uint8_t column = first; column <= last; column++) {
+		line[column].c &= ~LCD_CONSOLE_DIRTY;
+	}
+
+	if (!_display.clipWindow(x0, y0, x1, y1))
+		return;
+
+	// One window for all cells, each cell keeps its colors
+	_display.setWindow(x0, y0, x1, y1);
+	for (int16_t py = y0; py <= y1; py++) {
+		int16_t px = left;
+		for (uint8_t column = first; column <= last; column++) {
+			_display.writeGlyphRow(_font, 1, lcdGlyphRow(_font, line[column].c, py - top),
+					px, x0, x1, line[column].fg, line[column].bg);
+		}
+	}
+}
@@ -0,0 +1,159 @@
+/**  
+* @file console.h  
+* @brief Character cell console over a ILI9341 display,
+* only the cells that changed are sent to the display
+*  
+* @author Marcelo H Moraes 
+* 
+* @date 10/18/2026
+*
+* Copyright (c) 2021, Marcelo H Moraes
+* SPDX-License-Identifier: Apache-2.0
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+*
+* You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied.
+*
+* See the License for the specific language governing permissions and limitations under the License.
+*/ 
+
+#ifndef _CONSOLE_H_
+#define _CONSOLE_H_
+
+#include "ili9341.h"
+
+/**
+ * @brief  One cell of the console
+ *         The bit 7 of the character marks a cell waiting to be drawn
+ */
+typedef struct {
+	uint8_t c;
+	uint16_t fg;
+	uint16_t bg;
+} lcdConsoleCell_t;
+
+#define LCD_CONSOLE_DIRTY	0x80
+
+/**
+ * @brief Console of characters with a shadow of the cells in screen.
+ *        Writes only change the shadow, flush send to display the
+ *        cells that changed, adjacent cells in a row are drawn in one window.
+ *        With LCD_THREAD_SAFE writes and flush share the display lock, so
+ *        a flush by another thread never loses a cell written meanwhile.
+ *
+ * @code
+ * static lcdConsoleCell_t cells[40 * 30];
+ * ILI9341Console console(display, cells, 40, 30, &Font8);
+ * console.printf("Temp %3d C", temp);
+ * console.flush();
+ * @endcode
+ */
+class ILI9341Console {
+protected:
+
+	ILI9341 &_display;
+	lcdConsoleCell_t *_cells;
+	font_t *_font;
+	uint8_t _columns;
+	uint8_t _rows;
+	int16_t _x;
+	int16_t _y;
+
+	uint8_t _column = 0;
+	uint8_t _row = 0;
+	uint16_t _fg = GREEN;
+	uint16_t _bg = BLACK;
+
+	void drawRun(uint8_t row, uint8_t first, uint8_t last);
+	void newLine(void);
+
+public:
+
+	/**
+	 * @brief Create a console over the display
+	 *
+	 * @param display	Display where the console is drawn
+	 * @param cells		Buffer with columns * rows cells, owned by the caller
+	 * @param columns	Number of columns
+	 * @param rows		Number of rows
+	 * @param font		Font of the console
+	 * @param x			x-coordinate of the top left corner
+	 * @param y			y-coordinate of the top left corner
+	 */
+	ILI9341Console(ILI9341 &display, lcdConsoleCell_t *cells,
+			uint8_t columns, uint8_t rows, font_t *font = &Font12,
+			int16_t x = 0, int16_t y = 0);
+
+	/**
+	 * @brief Fill all cells with spaces and move the cursor to home
+	 *
+	 * @param bg	Background color
+	 *
+	 * @return void
+	 */
+	void clear(uint16_t bg);
+
+	/**
+	 * @brief Mark all cells to be drawn in next flush,
+	 *        used when something else was drawn over the console
+	 *
+	 * @return void
+	 */
+	void invalidate(void);
+
+	/**
+	 * @brief Set the colors of next characters
+	 *
+	 * @param fg	Text color
+	 * @param bg	Background color
+	 *
+	 * @return void
+	 */
+	void setTextColor(uint16_t fg, uint16_t bg);
+
+	/**
+	 * @brief Set the cursor position in cells
+	 *
+	 * @return void
+	 */
+	void setCursor(uint8_t column, uint8_t row);
+
+	/**
+	 * @brief Write a cell, it is marked to redraw only if it changed
+	 *
+	 * @return void
+	 */
+	void setCell(uint8_t column, uint8_t row, char c, uint16_t fg, uint16_t bg);
+
+	/**
+	 * @brief Write a character in cursor position, '\n' and '\r' move the cursor
+	 *        When the cursor pass the last row the console scrolls up
+	 *
+	 * @return void
+	 */
+	void putChar(char c);
+	void print(const char *text);
+	void printf(const char *fmt, ...);
+
+	/**
+	 * @brief Move all rows up one row, last row is filled with spaces
+	 *
+	 * @return void
+	 */
+	void scroll(void);
+
+	/**
+	 * @brief Draw the cells that changed since last flush
+	 *
+	 * @return uint16_t	Number of cells drawn
+	 */
+	uint16_t flush(void);
+
+};
+
+#endif  /* _CONSOLE_H_ */
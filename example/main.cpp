@@ -20,6 +20,7 @@ uint32_t testFilledTriangles();
 uint32_t testRoundRects();
 uint32_t testFilledRoundRects();
 uint32_t testDrawImage();
+void testGlyphs(uint32_t *runtime, uint32_t *compiled);
 
 int main() {
     display.begin();
@@ -44,6 +45,8 @@ typedef struct {
     uint32_t drawRoundRects;
     uint32_t fillRoundRects;
     uint32_t drawImage;
+    uint32_t glyphRuntime;
+    uint32_t glyphCompiled;
 } test_t;
 
 void demoLCD() {
@@ -68,6 +71,7 @@ void demoLCD() {
     total += t.fillRoundRects = testFilledRoundRects();
     total += t.drawImage = testDrawImage();
     timer.stop();
+    testGlyphs(&t.glyphRuntime, &t.glyphCompiled);
 
     uint32_t id = display.getControllerID();
     display.fillScreen(BLACK);
@@ -90,6 +94,8 @@ void demoLCD() {
     display.printf("fillRoundRects   %03d ms\r\n", t.fillRoundRects);
     display.printf("Image            %03d ms\r\n", t.drawImage);
     display.printf("TOTAL            %03d ms\r\n", total);
+    display.printf("glyph runtime    %d cycles\r\n", t.glyphRuntime);
+    display.printf("glyph Font24_t   %d cycles\r\n", t.glyphCompiled);
     display.setTextColor(RED, BLACK);
     display.printf("\nEnd test, reset to other run.\r\n");
     while(true);
@@ -390,3 +396,18 @@ uint32_t testDrawImage() {
     return t;
 }
 
+
+void testGlyphs(uint32_t *runtime, uint32_t *compiled) {
+    // Cycles per glyph of Font24, measured with DWT cycle counter
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    display.fillScreen(BLACK);
+    display.setTextFont(&Font24);
+    uint32_t start = DWT->CYCCNT;
+    for(char c = 0x20; c < 0x7F; c++) display.drawChar(0, 0, c, WHITE, BLACK);
+    *runtime = (DWT->CYCCNT - start) / (0x7F - 0x20);
+    start = DWT->CYCCNT;
+    for(char c = 0x20; c < 0x7F; c++) display.drawChar<Font24_t>(0, 0, c, WHITE, BLACK);
+    *compiled = (DWT->CYCCNT - start) / (0x7F - 0x20);
+    ThisThread::sleep_for(1s);
+}
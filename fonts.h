@@ -76,6 +76,12 @@ extern font_t Font20;
 extern font_t Font16;
 extern font_t Font12;
 extern font_t Font8;
+
+extern const uint8_t Font24_Table[];
+extern const uint8_t Font20_Table[];
+extern const uint8_t Font16_Table[];
+extern const uint8_t Font12_Table[];
+extern const uint8_t Font8_Table[];
 /**
  * @}
  */
@@ -105,6 +111,36 @@ extern font_t Font8;
 
 #ifdef __cplusplus
 }
+
+/**
+ * @brief  Font known at compile time, the sizes are constants
+ *         so the renderers can be specialized for each font
+ */
+template<uint16_t WIDTH, uint16_t HEIGHT, const uint8_t *TABLE, font_t *FONT>
+struct fontDescriptor_t {
+	static const uint16_t Width = WIDTH;
+	static const uint16_t Height = HEIGHT;
+	static const uint16_t BytesPerRow = (WIDTH + 7) / 8;
+	static const uint16_t BytesPerGlyph = BytesPerRow * HEIGHT;
+
+	/* Glyph of character c, characters out of font are a space */
+	static inline const uint8_t *glyph(uint8_t c) {
+		if (c < 0x20 || c > 0x7E)
+			c = ' ';
+		return &TABLE[(c - 0x20) * BytesPerGlyph];
+	}
+
+	/* Same font for the runtime renderer */
+	static inline font_t *font(void) {
+		return FONT;
+	}
+};
+
+typedef fontDescriptor_t<17, 24, Font24_Table, &Font24> Font24_t;
+typedef fontDescriptor_t<14, 20, Font20_Table, &Font20> Font20_t;
+typedef fontDescriptor_t<11, 16, Font16_Table, &Font16> Font16_t;
+typedef fontDescriptor_t<7, 12, Font12_Table, &Font12> Font12_t;
+typedef fontDescriptor_t<5, 8, Font8_Table, &Font8> Font8_t;
 #endif
 
 #endif /* __FONTS_H */
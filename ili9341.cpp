@@ -23,6 +23,7 @@
 */ 
 
 #include <cstdint>
+#include <math.h>
 #include <stdlib.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -53,6 +54,147 @@ static unsigned char lcdBuildMemoryAccessControlConfig(
  */
 static void FSMC_init();
 
+/*!
+ * @brief  Order of pixels in a batch, by row and then by column
+ */
+static int lcdComparePixels(const void *a, const void *b);
+
+/*!
+ * @brief  Position in the panel of an address written with a MEMCONTROL config
+ */
+static void lcdAddressToPanel(uint8_t config, int16_t x, int16_t y, int16_t *column, int16_t *row);
+
+/*!
+ * @brief  Address that reaches a position of the panel with a MEMCONTROL config
+ */
+static void lcdPanelToAddress(uint8_t config, int16_t column, int16_t row, int16_t *x, int16_t *y);
+
+/*!
+ * @brief  First row of a polyline segment
+ */
+static int16_t lcdSegmentTop(const lcdPoint_t *points, uint16_t count, uint16_t segment);
+
+/*!
+ * @brief  Polyline segment in the active list, offsets in 24.8 fixed point
+ *         computed once when the scanline reaches the segment
+ */
+typedef struct {
+	uint16_t segment;
+	int16_t bottom;         // Last row of the segment
+	int32_t nx, ny;         // Half width normal of the rectangle
+	int32_t ax, ay;         // Outer half width normal at the end, for the join
+	int32_t bx, by;         // Outer half width normal of the next segment
+	int32_t mx, my;         // Miter tip from the end point
+	uint8_t join;           // Corners of the join, 0 without join and 1 round
+} lcdPolySegment_t;
+
+/*!
+ * @brief  Precompute the rectangle and the join of a polyline segment
+ */
+static void lcdPolySegmentStart(lcdPolySegment_t *shape, const lcdPoint_t *points, uint16_t count,
+		uint16_t segment, uint16_t width, lcdLineJoin_t join);
+
+/*!
+ * @brief  Range of x in a scanline inside a convex polygon, vertices in 24.8 fixed point
+ */
+static void lcdConvexSpan(const int32_t *vx, const int32_t *vy, uint8_t count,
+		int32_t y, int32_t *x0, int32_t *x1);
+
+/*!
+ * @brief  Range of x in a scanline inside a disc, center and radius in 24.8 fixed point
+ */
+static void lcdDiscSpan(int32_t cx, int32_t cy, int32_t radius, int32_t y, int32_t *x0, int32_t *x1);
+
+/*!
+ * @brief  Range of x where k * x + c >= m
+ */
+static void lcdLinearRange(int64_t k, int64_t c, int64_t m, int32_t *x0, int32_t *x1);
+
+/*!
+ * @brief  Integer square root
+ */
+static uint32_t lcdSqrt(uint32_t value);
+
+/*!
+ * @brief  Color channels in 565 levels, 16.16 fixed point, and their step
+ */
+typedef struct {
+	int32_t r, g, b;
+	int32_t dr, dg, db;
+} lcdColorRamp_t;
+
+/*!
+ * @brief  Start a ramp of steps colors, at step first
+ */
+static void lcdRampStart(lcdColorRamp_t *ramp, uint16_t from, uint16_t to, int32_t steps, int32_t first);
+
+/*!
+ * @brief  Color of the ramp at step, rounded up when the fraction passes threshold
+ */
+static uint16_t lcdRampColor(const lcdColorRamp_t *ramp, int32_t step, uint16_t threshold);
+
+/*!
+ * @brief  Blend two pairs of 565 pixels, alpha from 0 to 32
+ */
+static inline uint32_t lcdBlendPair(uint32_t fg, uint32_t bg, uint32_t alpha);
+
+/*!
+ * @brief  Add bytes to a capture, sending the buffer when full
+ */
+static void lcdCapturePut(lcdCapture_t *capture, const uint8_t *data, uint16_t length);
+
+/*!
+ * @brief  Send the bytes waiting in a capture
+ */
+static void lcdCaptureFlush(lcdCapture_t *capture);
+
+/*!
+ * @brief  Compress a row of pixels into a capture
+ */
+static void lcdCaptureRow(lcdCapture_t *capture, const uint16_t *pixels, uint16_t count);
+
+/*!
+ * @brief  Sine of an angle in degrees, 2.14 fixed point
+ */
+static int32_t lcdSin(int16_t angle);
+
+/*!
+ * @brief  Find the next line of a text inside a box, with word wrap
+ */
+static const char *lcdNextTextLine(uint16_t charWidth, const char *text,
+		uint16_t boxWidth, lcdTextAlign_t align, lcdTextLine_t *line);
+
+/*!
+ * @brief  4x4 ordered dither thresholds, in 1/65536 of a level
+ */
+static const uint16_t lcdDitherThreshold[4][4] = {
+	{ 0x0800, 0x8800, 0x2800, 0xA800 },
+	{ 0xC800, 0x4800, 0xE800, 0x6800 },
+	{ 0x3800, 0xB800, 0x1800, 0x9800 },
+	{ 0xF800, 0x7800, 0xD800, 0x5800 }
+};
+
+/*!
+ * @brief  Sine from 0 to 90 degrees, 2.14 fixed point
+ */
+static const int16_t lcdSineTable[91] = {
+	0, 286, 572, 857, 1143, 1428, 1713, 1997, 2280, 2563,
+	2845, 3126, 3406, 3686, 3964, 4240, 4516, 4790, 5063, 5334,
+	5604, 5872, 6138, 6402, 6664, 6924, 7182, 7438, 7692, 7943,
+	8192, 8438, 8682, 8923, 9162, 9397, 9630, 9860, 10087, 10311,
+	10531, 10749, 10963, 11174, 11381, 11585, 11786, 11982, 12176, 12365,
+	12551, 12733, 12911, 13085, 13255, 13421, 13583, 13741, 13894, 14044,
+	14189, 14330, 14466, 14598, 14726, 14849, 14968, 15082, 15191, 15296,
+	15396, 15491, 15582, 15668, 15749, 15826, 15897, 15964, 16026, 16083,
+	16135, 16182, 16225, 16262, 16294, 16322, 16344, 16362, 16374, 16382,
+	16384
+};
+
+/*!
+ * @brief  Formatted text of printf, shared under the display lock
+ */
+static char lcdPrintBuffer[256];
+
 /* --- Public methods --- */
 
 ILI9341::ILI9341(PinName rst, PinName bl,
@@ -63,9 +205,11 @@ ILI9341::ILI9341(PinName rst, PinName bl,
 	Properties.orientation = orientation;
 	fsmcCMD = (volatile uint16_t*)NEx;
 	fsmcDATA = (volatile uint16_t*)(NEx+Ax);
+	resetClip();
 }
 
 void ILI9341::begin(void) {
+	LCD_LOCK(*this);
 	PortraitConfig = lcdBuildMemoryAccessControlConfig(
 			MemoryAccessControlNormalOrder,		// rowAddressOrder
 			MemoryAccessControlReverseOrder,	// columnAddressOrder
@@ -135,6 +279,7 @@ void ILI9341::begin(void) {
 
 	writeCommand(ILI9341_MEMCONTROL);
 	writeData(PortraitConfig);
+	MemoryConfig = PortraitConfig;
 
 	writeCommand(ILI9341_PIXELFORMAT);
 	writeData(0x55);
@@ -185,6 +330,7 @@ void ILI9341::begin(void) {
 }
 
 void ILI9341::test(void) {
+	LCD_LOCK(*this);
 	setWindow(0, 0, Properties.width - 1, Properties.height - 1);
 	
 	uint8_t stripSize = Properties.height / 8;
@@ -216,39 +362,101 @@ uint16_t ILI9341::color565(uint8_t r, uint8_t g, uint8_t b) {
 }
 
 void ILI9341::fillScreen(uint16_t color) {
-	setWindow(0, 0, Properties.width - 1, Properties.height - 1);
-	int dimensions = Properties.width * Properties.height;
-	while (dimensions--) {
-		writeData(color);
-	}
+	LCD_LOCK(*this);
+	// With a clip set only the clip area is filled, an empty clip fills nothing
+	fillWindow(Clip.x0, Clip.y0, Clip.x1, Clip.y1, color);
 }
 
-void ILI9341::drawPixel(uint16_t x, uint16_t y, uint16_t color) {
-	// Clip
-	if ((x < 0) || (y < 0) || (x >= Properties.width)
-			|| (y >= Properties.height))
-		return;
+void ILI9341::drawPixel(int16_t x, int16_t y, uint16_t color) {
+	LCD_LOCK(*this);
+	writePixel(x + Clip.originX, y + Clip.originY, color);
+}
 
-	setWindow(x, y, x, y);
-	writeData(color);
+void ILI9341::drawPixelBatch(lcdPixel_t *points, uint16_t count) {
+	LCD_LOCK(*this);
+	int16_t page = -1;
+	int16_t columnStart = -1, columnEnd = -1;
+
+	qsort(points, count, sizeof(lcdPixel_t), lcdComparePixels);
+
+	for (uint16_t i = 0, end; i < count; i = end) {
+		// Run of touching pixels in the same row
+		for (end = i + 1; end < count && points[end].y == points[i].y
+				&& points[end].x <= points[end - 1].x + 1; end++)
+			;
+
+		int16_t y = points[i].y + Clip.originY;
+		int16_t x0 = points[i].x + Clip.originX;
+		int16_t x1 = points[end - 1].x + Clip.originX;
+		if (y < Clip.y0 || y > Clip.y1)
+			continue;
+		if (x0 < Clip.x0)
+			x0 = Clip.x0;
+		if (x1 > Clip.x1)
+			x1 = Clip.x1;
+		if (x0 > x1)
+			continue;
+
+		// Only the address that changed from the last run is sent
+		if (y != page) {
+			setPages(y, y);
+			page = y;
+		}
+		if (x0 != columnStart || x1 != columnEnd) {
+			setColumns(x0, x1);
+			columnStart = x0;
+			columnEnd = x1;
+		}
+		writeCommand(ILI9341_MEMORYWRITE);
+		for (uint16_t k = i; k < end; k++) {
+			int16_t x = points[k].x + Clip.originX;
+			// Repeated positions write only the last one
+			if (x < x0 || x > x1 || (k + 1 < end && points[k + 1].x == points[k].x))
+				continue;
+			writeData(points[k].color);
+		}
+	}
 }
 
-void ILI9341::drawPixels(uint16_t x, uint16_t y, uint16_t *data, uint32_t dataLength) {
+void ILI9341::drawPixels(int16_t x, int16_t y, uint16_t *data, uint32_t dataLength) {
+	LCD_LOCK(*this);
+	x += Clip.originX;
+	y += Clip.originY;
 
-	setWindow(x, y, Properties.width - 1, Properties.height - 1);
+	// Pixels go to right and continue in next row, from x to right border of clip
+	int16_t rowLength = Clip.x1 - x + 1;
+	if (rowLength <= 0 || dataLength == 0)
+		return;
 
-	do {
-		writeData(*data++);
-	} while (--dataLength);
+	for (; dataLength > 0 && y <= Clip.y1; y++) {
+		uint16_t length = dataLength < (uint32_t)rowLength ? dataLength : rowLength;
+		if (y >= Clip.y0)
+			writeClippedPixels(x, y, data, length);
+		data += length;
+		dataLength -= length;
+	}
 }
 
 void ILI9341::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+	LCD_LOCK(*this);
 	// Bresenham's algorithm - thx wikpedia
+	// The pixels are the same of the classic loop, but the line is clipped
+	// before and sent in runs: horizontal for shallow lines, vertical for steep ones
+
+	int16_t xmin = Clip.x0, xmax = Clip.x1;
+	int16_t ymin = Clip.y0, ymax = Clip.y1;
+
+	x0 += Clip.originX;
+	y0 += Clip.originY;
+	x1 += Clip.originX;
+	y1 += Clip.originY;
 
 	int16_t steep = abs(y1 - y0) > abs(x1 - x0);
 	if (steep) {
 		swap(x0, y0);
 		swap(x1, y1);
+		swap(xmin, ymin);
+		swap(xmax, ymax);
 	}
 
 	if (x0 > x1) {
@@ -256,11 +464,11 @@ void ILI9341::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t
 		swap(y0, y1);
 	}
 
-	int16_t dx, dy;
+	int32_t dx, dy;
 	dx = x1 - x0;
 	dy = abs(y1 - y0);
 
-	int16_t err = dx / 2;
+	int32_t half = dx / 2;
 	int16_t ystep;
 
 	if (y0 < y1) {
@@ -269,68 +477,92 @@ void ILI9341::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t
 		ystep = -1;
 	}
 
-	for (; x0 <= x1; x0++) {
-		if (steep) {
-			drawPixel(y0, x0, color);
+	// Trivial reject, the bounding box is out of clip
+	if (x1 < xmin || x0 > xmax
+			|| (y0 < ymin && y1 < ymin) || (y0 > ymax && y1 > ymax))
+		return;
+
+	// Clip in the domain of the steps i along major axis, like Liang-Barsky.
+	// After i steps the minor axis moved k(i) = ceil((i * dy - half) / dx)
+	int32_t first = (xmin > x0) ? xmin - x0 : 0;
+	int32_t last = (xmax - x0 < dx) ? xmax - x0 : dx;
+
+	if (dy != 0) {
+		int32_t kmin, kmax, i;
+		if (ystep > 0) {
+			kmin = ymin - y0;
+			kmax = ymax - y0;
 		} else {
-			drawPixel(x0, y0, color);
+			kmin = y0 - ymax;
+			kmax = y0 - ymin;
 		}
+		if (kmin > 0) {
+			// First step with k(i) >= kmin
+			i = ((int64_t)(kmin - 1) * dx + half) / dy + 1;
+			if (i > first)
+				first = i;
+		}
+		if (kmax < dy) {
+			// Last step with k(i) <= kmax
+			i = ((int64_t)kmax * dx + half) / dy;
+			if (i < last)
+				last = i;
+		}
+	}
+
+	if (first > last)
+		return;
+
+	if (dx == 0) {
+		fillWindow(x0, y0, x0, y0, color);
+		return;
+	}
+
+	// Start the error at the first visible step
+	int32_t k = ((int64_t)first * dy - half + dx - 1) / dx;
+	int32_t err = half - first * dy + k * dx;
+	int16_t y = y0 + ystep * k;
+	int16_t start = x0 + first;
+
+	for (int32_t i = first; i <= last; i++) {
 		err -= dy;
-		if (err < 0) {
-			y0 += ystep;
+		if (err < 0 || i == last) {
+			// End of run, one window for all pixels with same minor coordinate
+			if (steep) {
+				fillWindow(y, start, y, x0 + i, color);
+			} else {
+				fillWindow(start, y, x0 + i, y, color);
+			}
+			start = x0 + i + 1;
+			y += ystep;
 			err += dx;
 		}
 	}
 }
 
-void ILI9341::drawFastHLine(uint16_t x, uint16_t y, uint16_t width, uint16_t color) {
+void ILI9341::drawFastHLine(int16_t x, int16_t y, int16_t width, uint16_t color) {
+	LCD_LOCK(*this);
 	// Allows for slightly better performance than setting individual pixels
-
 	if (width < x) {
 		// Switch direction
 		swap(x, width);
 	}
 
-	// Check limits
-	if (width >= Properties.width) {
-		width = Properties.width - 1;
-	}
-
-	if (x >= Properties.width) {
-		x = Properties.width - 1;
-	}
-
-	setWindow(x, y, width, y);
-	for (int line = x; line <= width; line++) {
-		writeData(color);
-	}
+	fillWindow(x + Clip.originX, y + Clip.originY, width + Clip.originX, y + Clip.originY, color);
 }
 
-void ILI9341::drawFastVLine(uint16_t x, uint16_t y, uint16_t height, uint16_t color) {
+void ILI9341::drawFastVLine(int16_t x, int16_t y, int16_t height, uint16_t color) {
+	LCD_LOCK(*this);
 	if (height < y) {
         // Switch direction
 		swap(y, height);
 	}
 
-	if (x >= Properties.width) {
-		x = Properties.width - 1;
-	}
-
-	if (y >= Properties.height) {
-		y = Properties.height - 1;
-	}
-
-	if (height >= Properties.height) {
-		height = Properties.height - 1;
-	}
-
-	setWindow(x, y, x, height);
-	for (int line = y; line <= height; line++) {
-		writeData(color);
-	}
+	fillWindow(x + Clip.originX, y + Clip.originY, x + Clip.originX, height + Clip.originY, color);
 }
 
 void ILI9341::drawRect(int16_t x, int16_t y, int16_t width, int16_t height, uint16_t color) {
+	LCD_LOCK(*this);
 	drawFastHLine(x, y, x + width - 1, color);
 	drawFastHLine(x, y + height - 1, x + width - 1, color);
 	drawFastVLine(x, y, y + height - 1, color);
@@ -338,20 +570,89 @@ void ILI9341::drawRect(int16_t x, int16_t y, int16_t width, int16_t height, uint
 }
 
 void ILI9341::fillRect(int16_t x, int16_t y, int16_t width, int16_t height,	uint16_t fillcolor) {
-	// clipping
-	if ((x >= Properties.width) || (y >= Properties.height))
+	LCD_LOCK(*this);
+	if (width <= 0 || height <= 0)
+		return;
+
+	x += Clip.originX;
+	y += Clip.originY;
+
+	// One window for all rectangle, clipped
+	fillWindow(x, y, x + width - 1, y + height - 1, fillcolor);
+}
+
+void ILI9341::fillRectGradient(int16_t x, int16_t y, int16_t width, int16_t height, uint16_t from, uint16_t to,
+		lcdGradient_t direction, bool dither) {
+	LCD_LOCK(*this);
+	// Rows of colors, the clipped width is at most the screen height
+	static uint16_t rows[4][ILI9341_PIXEL_HEIGHT];
+	lcdColorRamp_t ramp;
+
+	if (width <= 0 || height <= 0)
+		return;
+
+	x += Clip.originX;
+	y += Clip.originY;
+	int16_t x0 = x, y0 = y, x1 = x + width - 1, y1 = y + height - 1;
+	if (!clipWindow(x0, y0, x1, y1))
 		return;
-	if ((x + width - 1) >= Properties.width)
-		width = Properties.width - x;
-	if ((y + height - 1) >= Properties.height)
-		height = Properties.height - y;
 
-	for (int16_t y1 = y; y1 <= y + height; y1++) {
-		drawFastHLine(x, y1, x + width, fillcolor);
+	setWindow(x0, y0, x1, y1);
+	uint16_t columns = x1 - x0 + 1;
+
+	if (direction == LCD_GRADIENT_VERTICAL) {
+		lcdRampStart(&ramp, from, to, height, y0 - y);
+		for (int16_t py = y0; py <= y1; py++) {
+			const uint16_t *threshold = lcdDitherThreshold[py & 3];
+			int32_t step = py - y0;
+			if (!dither) {
+				writeColor(lcdRampColor(&ramp, step, 0x8000), columns);
+				continue;
+			}
+			// Dithered rows repeat every four pixels
+			uint16_t pattern[4];
+			for (uint8_t k = 0; k < 4; k++)
+				pattern[k] = lcdRampColor(&ramp, step, threshold[(x0 + k) & 3]);
+			if (pattern[0] == pattern[1] && pattern[0] == pattern[2] && pattern[0] == pattern[3]) {
+				writeColor(pattern[0], columns);
+			} else {
+				for (uint16_t px = 0; px < columns; px++)
+					writeData(pattern[px & 3]);
+			}
+		}
+	} else {
+		// Rows four apart have the same dither thresholds, without dithering all rows are the same
+		uint8_t patterns = dither ? 4 : 1;
+		lcdRampStart(&ramp, from, to, width, x0 - x);
+		for (uint8_t k = 0; k < patterns; k++) {
+			const uint16_t *threshold = lcdDitherThreshold[(y0 + k) & 3];
+			for (uint16_t px = 0; px < columns; px++)
+				rows[k][px] = lcdRampColor(&ramp, px, dither ? threshold[(x0 + px) & 3] : 0x8000);
+		}
+		for (int16_t py = y0; py <= y1; py++) {
+			const uint16_t *row = rows[(py - y0) % patterns];
+			for (uint16_t px = 0; px < columns; px++)
+				writeData(row[px]);
+		}
 	}
 }
 
+void ILI9341::fillRectAlpha(int16_t x, int16_t y, int16_t width, int16_t height, uint16_t color, uint8_t alpha) {
+	LCD_LOCK(*this);
+	if (width <= 0 || height <= 0 || alpha == 0)
+		return;
+
+	x += Clip.originX;
+	y += Clip.originY;
+
+	if (alpha == 255)
+		fillWindow(x, y, x + width - 1, y + height - 1, color);
+	else
+		blendWindow(x, y, x + width - 1, y + height - 1, NULL, color, alpha);
+}
+
 void ILI9341::drawRoundRect(int16_t x, int16_t y, int16_t width, int16_t height, int16_t radius, uint16_t color) {
+	LCD_LOCK(*this);
 	// smarter version
 	drawFastHLine(x + radius, y, x + width - radius, color);
 	drawFastHLine(x + radius, y + height - 1, x + width - radius, color);
@@ -366,6 +667,7 @@ void ILI9341::drawRoundRect(int16_t x, int16_t y, int16_t width, int16_t height,
 }
 
 void ILI9341::fillRoundRect(int16_t x, int16_t y, int16_t width, int16_t height, int16_t radius, uint16_t color) {
+	LCD_LOCK(*this);
 	// smarter version
 	fillRect(x + radius, y, width - 2 * radius, height, color);
 
@@ -375,16 +677,20 @@ void ILI9341::fillRoundRect(int16_t x, int16_t y, int16_t width, int16_t height,
 }
 
 void ILI9341::drawCircle(int16_t x0, int16_t y0, int16_t radius, uint16_t color) {
+	LCD_LOCK(*this);
+	x0 += Clip.originX;
+	y0 += Clip.originY;
+
 	int16_t f = 1 - radius;
 	int16_t ddF_x = 1;
 	int16_t ddF_y = -2 * radius;
 	int16_t x = 0;
 	int16_t y = radius;
 
-	drawPixel(x0, y0 + radius, color);
-	drawPixel(x0, y0 - radius, color);
-	drawPixel(x0 + radius, y0, color);
-	drawPixel(x0 - radius, y0, color);
+	writePixel(x0, y0 + radius, color);
+	writePixel(x0, y0 - radius, color);
+	writePixel(x0 + radius, y0, color);
+	writePixel(x0 - radius, y0, color);
 
 	while (x < y) {
 		if (f >= 0) {
@@ -396,23 +702,28 @@ void ILI9341::drawCircle(int16_t x0, int16_t y0, int16_t radius, uint16_t color)
 		ddF_x += 2;
 		f += ddF_x;
 
-		drawPixel(x0 + x, y0 + y, color);
-		drawPixel(x0 - x, y0 + y, color);
-		drawPixel(x0 + x, y0 - y, color);
-		drawPixel(x0 - x, y0 - y, color);
-		drawPixel(x0 + y, y0 + x, color);
-		drawPixel(x0 - y, y0 + x, color);
-		drawPixel(x0 + y, y0 - x, color);
-		drawPixel(x0 - y, y0 - x, color);
+		writePixel(x0 + x, y0 + y, color);
+		writePixel(x0 - x, y0 + y, color);
+		writePixel(x0 + x, y0 - y, color);
+		writePixel(x0 - x, y0 - y, color);
+		writePixel(x0 + y, y0 + x, color);
+		writePixel(x0 - y, y0 + x, color);
+		writePixel(x0 + y, y0 - x, color);
+		writePixel(x0 - y, y0 - x, color);
 	}
 }
 
 void ILI9341::fillCircle(int16_t x0, int16_t y0, int16_t radius, uint16_t color) {
-	drawFastVLine(x0, y0 - radius, y0 + radius + 1, color);
+	LCD_LOCK(*this);
+	drawFastVLine(x0, y0 - radius, y0 + radius, color);
 	fillCircleHelper(x0, y0, radius, 3, 0, color);
 }
 
 void ILI9341::drawCircleHelper(int16_t x0, int16_t y0, int16_t radius, uint8_t cornername, uint16_t color) {
+	LCD_LOCK(*this);
+	x0 += Clip.originX;
+	y0 += Clip.originY;
+
 	int16_t f = 1 - radius;
 	int16_t ddF_x = 1;
 	int16_t ddF_y = -2 * radius;
@@ -429,25 +740,26 @@ void ILI9341::drawCircleHelper(int16_t x0, int16_t y0, int16_t radius, uint8_t c
 		ddF_x += 2;
 		f += ddF_x;
 		if (cornername & 0x4) {
-			drawPixel(x0 + x, y0 + y, color);
-			drawPixel(x0 + y, y0 + x, color);
+			writePixel(x0 + x, y0 + y, color);
+			writePixel(x0 + y, y0 + x, color);
 		}
 		if (cornername & 0x2) {
-			drawPixel(x0 + x, y0 - y, color);
-			drawPixel(x0 + y, y0 - x, color);
+			writePixel(x0 + x, y0 - y, color);
+			writePixel(x0 + y, y0 - x, color);
 		}
 		if (cornername & 0x8) {
-			drawPixel(x0 - y, y0 + x, color);
-			drawPixel(x0 - x, y0 + y, color);
+			writePixel(x0 - y, y0 + x, color);
+			writePixel(x0 - x, y0 + y, color);
 		}
 		if (cornername & 0x1) {
-			drawPixel(x0 - y, y0 - x, color);
-			drawPixel(x0 - x, y0 - y, color);
+			writePixel(x0 - y, y0 - x, color);
+			writePixel(x0 - x, y0 - y, color);
 		}
 	}
 }
 
 void ILI9341::fillCircleHelper(int16_t x0, int16_t y0, int16_t radius, uint8_t cornername, int16_t delta, uint16_t color) {
+	LCD_LOCK(*this);
 	int16_t f = 1 - radius;
 	int16_t ddF_x = 1;
 	int16_t ddF_y = -2 * radius;
@@ -465,26 +777,110 @@ void ILI9341::fillCircleHelper(int16_t x0, int16_t y0, int16_t radius, uint8_t c
 		f += ddF_x;
 
 		if (cornername & 0x1) {
-			drawFastVLine(x0 + x, y0 - y, y0 + y + 1 + delta, color);
-			drawFastVLine(x0 + y, y0 - x, y0 + x + 1 + delta, color);
+			drawFastVLine(x0 + x, y0 - y, y0 + y + delta, color);
+			drawFastVLine(x0 + y, y0 - x, y0 + x + delta, color);
 		}
 		if (cornername & 0x2) {
-			drawFastVLine(x0 - x, y0 - y, y0 + y + 1 + delta, color);
-			drawFastVLine(x0 - y, y0 - x, y0 + x + 1 + delta, color);
+			drawFastVLine(x0 - x, y0 - y, y0 + y + delta, color);
+			drawFastVLine(x0 - y, y0 - x, y0 + x + delta, color);
+		}
+	}
+}
+
+void ILI9341::drawArc(int16_t x0, int16_t y0, uint16_t radius, int16_t start, int16_t end, uint16_t color) {
+	LCD_LOCK(*this);
+	fillSector(x0 + Clip.originX, y0 + Clip.originY, radius ? radius - 1 : 0, radius, start, end, color);
+}
+
+void ILI9341::fillArc(int16_t x0, int16_t y0, uint16_t innerRadius, uint16_t outerRadius,
+		int16_t start, int16_t end, uint16_t color) {
+	LCD_LOCK(*this);
+	fillSector(x0 + Clip.originX, y0 + Clip.originY, innerRadius, outerRadius, start, end, color);
+}
+
+void ILI9341::fillPie(int16_t x0, int16_t y0, uint16_t radius, int16_t start, int16_t end, uint16_t color) {
+	LCD_LOCK(*this);
+	fillSector(x0 + Clip.originX, y0 + Clip.originY, 0, radius, start, end, color);
+	// The apex is on both rays, which narrow sectors leave out
+	if (end > start && end - start <= 180)
+		drawPixel(x0, y0, color);
+}
+
+void ILI9341::updateArc(int16_t x0, int16_t y0, uint16_t innerRadius, uint16_t outerRadius,
+		int16_t oldEnd, int16_t newEnd, uint16_t color, uint16_t bg) {
+	LCD_LOCK(*this);
+	// Sectors are half open, so the delta ends exactly where the gauge does
+	if (newEnd > oldEnd)
+		fillSector(x0 + Clip.originX, y0 + Clip.originY, innerRadius, outerRadius, oldEnd, newEnd, color);
+	else if (newEnd < oldEnd)
+		fillSector(x0 + Clip.originX, y0 + Clip.originY, innerRadius, outerRadius, newEnd, oldEnd, bg);
+}
+
+void ILI9341::drawEllipse(int16_t x0, int16_t y0, uint16_t radiusX, uint16_t radiusY, uint16_t color) {
+	LCD_LOCK(*this);
+	drawEllipseRows(x0 + Clip.originX, y0 + Clip.originY, radiusX, radiusY, color, false);
+}
+
+void ILI9341::fillEllipse(int16_t x0, int16_t y0, uint16_t radiusX, uint16_t radiusY, uint16_t color) {
+	LCD_LOCK(*this);
+	drawEllipseRows(x0 + Clip.originX, y0 + Clip.originY, radiusX, radiusY, color, true);
+}
+
+void ILI9341::fillCircleGradient(int16_t x0, int16_t y0, uint16_t radius, uint16_t inner, uint16_t outer,
+		bool dither) {
+	LCD_LOCK(*this);
+	lcdColorRamp_t ramp;
+	lcdRampStart(&ramp, inner, outer, radius + 1, 0);
+
+	x0 += Clip.originX;
+	y0 += Clip.originY;
+
+	// Same pixels as fillPie, one window per scanline
+	int32_t limit = (int32_t)radius * radius + radius;
+	for (int32_t dy = -radius; dy <= radius; dy++) {
+		int16_t px0 = x0 - lcdSqrt(limit - dy * dy), py0 = y0 + dy;
+		int16_t px1 = x0 + (x0 - px0), py1 = py0;
+		if (!clipWindow(px0, py0, px1, py1))
+			continue;
+
+		setWindow(px0, py0, px1, py1);
+		const uint16_t *threshold = lcdDitherThreshold[py0 & 3];
+
+		// Distance to center follows the squared distance without a square root per pixel
+		int32_t dx = px0 - x0;
+		int32_t distance2 = dx * dx + dy * dy;
+		int32_t distance = lcdSqrt(distance2);
+		for (int16_t px = px0; px <= px1; px++, dx++) {
+			while (distance * distance > distance2)
+				distance--;
+			while ((distance + 1) * (distance + 1) <= distance2)
+				distance++;
+			writeData(lcdRampColor(&ramp, (distance > radius) ? radius : distance,
+					dither ? threshold[px & 3] : 0x8000));
+			distance2 += 2 * dx + 1;
 		}
 	}
 }
 
 void ILI9341::drawTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color) {
+	LCD_LOCK(*this);
 	drawLine(x0, y0, x1, y1, color);
 	drawLine(x1, y1, x2, y2, color);
 	drawLine(x2, y2, x0, y0, color);
 }
 
 void ILI9341::fillTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color) {
-
+	LCD_LOCK(*this);
 	int16_t a, b, y, last;
 
+	// Scanlines go straight to the window, in screen coordinates
+	x0 += Clip.originX;
+	x1 += Clip.originX;
+	x2 += Clip.originX;
+	y0 += Clip.originY;
+	y1 += Clip.originY;
+	y2 += Clip.originY;
+
 	// Sort coordinates by Y order (y2 >= y1 >= y0)
 	if (y0 > y1) {
 		swap(y0, y1);
@@ -509,7 +905,7 @@ void ILI9341::fillTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16
 			a = x2;
 		else if (x2 > b)
 			b = x2;
-		drawFastHLine(a, y0, b + 1, color);
+		fillWindow(a, y0, b, y0, color);
 		return;
 	}
 
@@ -539,7 +935,7 @@ void ILI9341::fillTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16
 		 */
 		if (a > b)
 			swap(a, b);
-		drawFastHLine(a, y, b + 1, color);
+		fillWindow(a, y, b, y, color);
 	}
 
 	// For lower part of triangle, find scanline crossings for segments
@@ -557,138 +953,629 @@ void ILI9341::fillTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16
 		 */
 		if (a > b)
 			swap(a, b);
-		drawFastHLine(a, y, b + 1, color);
+		fillWindow(a, y, b, y, color);
 	}
 }
 
-void ILI9341::drawImage(uint16_t x, uint16_t y, const sImage_t *pBitmap) {
-	if ((x >= Properties.width) || (y >= Properties.height))
-		return;
-	if ((x + pBitmap->width - 1) >= Properties.width)
-		return;
-	if ((y + pBitmap->height - 1) >= Properties.height)
+bool ILI9341::fillPolygon(const lcdPoint_t *points, uint16_t count, uint16_t color,
+		lcdFillRule_t rule, lcdEdge_t *edges, uint16_t maxEdges) {
+	LCD_LOCK(*this);
+	static lcdEdge_t edgeArena[LCD_POLYGON_MAX_EDGES];
+	uint16_t total = 0;
+
+	if (edges == NULL) {
+		edges = edgeArena;
+		maxEdges = LCD_POLYGON_MAX_EDGES;
+	}
+	if (count > maxEdges)
+		return false;
+	if (count < 3)
+		return true;
+
+	// Edge table, scanlines are sampled at pixel centers (y + 0.5)
+	for (uint16_t i = 0; i < count; i++) {
+		const lcdPoint_t *p = &points[i];
+		const lcdPoint_t *q = &points[(i + 1) % count];
+		if (p->y == q->y)
+			continue; // Horizontal edges don't cross any scanline
+
+		lcdEdge_t *edge = &edges[total];
+		edge->winding = (q->y > p->y) ? 1 : -1;
+		if (q->y < p->y) {
+			const lcdPoint_t *t = p;
+			p = q;
+			q = t;
+		}
+		edge->yTop = p->y + Clip.originY;
+		edge->yBottom = q->y + Clip.originY;
+		edge->dxdy = ((int64_t)(q->x - p->x) * 65536) / (q->y - p->y);
+		edge->x = (int32_t)(p->x + Clip.originX) * 65536 + edge->dxdy / 2;
+
+		// Skip the scanlines above the clip
+		if (edge->yBottom <= Clip.y0 || edge->yTop > Clip.y1)
+			continue;
+		if (edge->yTop < Clip.y0) {
+			edge->x += (int64_t)edge->dxdy * (Clip.y0 - edge->yTop);
+			edge->yTop = Clip.y0;
+		}
+		total++;
+	}
+
+	// Sort the edges by first scanline
+	for (uint16_t i = 1; i < total; i++) {
+		lcdEdge_t edge = edges[i];
+		uint16_t j = i;
+		for (; j > 0 && edges[j - 1].yTop > edge.yTop; j--)
+			edges[j] = edges[j - 1];
+		edges[j] = edge;
+	}
+
+	// Active edges are in [0, active), edges waiting are in [next, total)
+	uint16_t active = 0;
+	uint16_t next = 0;
+	int16_t y = total ? edges[0].yTop : 0;
+
+	while ((active > 0 || next < total) && y <= Clip.y1) {
+		if (active == 0 && edges[next].yTop > y)
+			y = edges[next].yTop;
+		while (next < total && edges[next].yTop == y)
+			edges[active++] = edges[next++];
+
+		// Active edges sorted by x, they are almost in order from last scanline
+		for (uint16_t i = 1; i < active; i++) {
+			lcdEdge_t edge = edges[i];
+			uint16_t j = i;
+			for (; j > 0 && edges[j - 1].x > edge.x; j--)
+				edges[j] = edges[j - 1];
+			edges[j] = edge;
+		}
+
+		// Spans with pixel centers inside, one window per span
+		int16_t winding = 0;
+		int32_t start = 0;
+		for (uint16_t i = 0; i < active; i++) {
+			int16_t before = winding;
+			if (rule == LCD_FILL_NONZERO)
+				winding += edges[i].winding;
+			else
+				winding ^= 1;
+			if (before == 0 && winding != 0) {
+				start = edges[i].x;
+			} else if (before != 0 && winding == 0) {
+				int16_t x0 = (start + 0x7FFF) >> 16;
+				int16_t x1 = ((edges[i].x + 0x7FFF) >> 16) - 1;
+				if (x0 <= x1)
+					fillWindow(x0, y, x1, y, color);
+			}
+		}
+
+		// Next scanline, edges that end are removed
+		y++;
+		uint16_t kept = 0;
+		for (uint16_t i = 0; i < active; i++) {
+			if (edges[i].yBottom > y) {
+				edges[i].x += edges[i].dxdy;
+				edges[kept++] = edges[i];
+			}
+		}
+		active = kept;
+	}
+	return true;
+}
+
+void ILI9341::drawThickLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t width,
+		uint16_t color, lcdLineCap_t cap) {
+	LCD_LOCK(*this);
+	const lcdPoint_t points[2] = { { x0, y0 }, { x1, y1 } };
+	drawPolyline(points, 2, width, color, LCD_JOIN_BEVEL, cap);
+}
+
+bool ILI9341::drawPolyline(const lcdPoint_t *points, uint16_t count, uint16_t width, uint16_t color,
+		lcdLineJoin_t join, lcdLineCap_t cap) {
+	LCD_LOCK(*this);
+	// Each segment is a bundle: its rectangle, the join at its end and the caps.
+	// Bundles are sorted by first scanline and active while the scanline cross them,
+	// their normals and miter are computed once when they become active
+	static uint16_t order[LCD_POLYLINE_MAX_POINTS];
+	static lcdPolySegment_t active[LCD_POLYLINE_MAX_POINTS];
+	static lcdSpan_t spans[3 * LCD_POLYLINE_MAX_POINTS];
+
+	if (count > LCD_POLYLINE_MAX_POINTS)
+		return false;
+	if (count == 0 || width == 0)
+		return true;
+
+	// Geometry in 24.8 fixed point at pixel centers, even widths are
+	// centered between pixels so they cover exactly width pixels
+	const int32_t radius = width * 128;
+	const int32_t shift = (width & 1) ? 0 : 128;
+	const int16_t reach = ((join == LCD_JOIN_MITER) ? 4 * width : width) / 2 + 2;
+	uint16_t bundles = (count > 1) ? count - 1 : 1;
+
+	for (uint16_t i = 0; i < bundles; i++) {
+		int16_t top = lcdSegmentTop(points, count, i);
+		uint16_t j = i;
+		for (; j > 0 && lcdSegmentTop(points, count, order[j - 1]) > top; j--)
+			order[j] = order[j - 1];
+		order[j] = i;
+	}
+
+	int16_t y = Clip.y0;
+	uint16_t activeCount = 0;
+	uint16_t next = 0;
+
+	for (; y <= Clip.y1 && (activeCount > 0 || next < bundles); y++) {
+		// New bundles reached by the scanline
+		while (next < bundles) {
+			uint16_t i = order[next];
+			if (lcdSegmentTop(points, count, i) + Clip.originY - reach > y)
+				break;
+			lcdPolySegmentStart(&active[activeCount++], points, count, i, width, join);
+			next++;
+		}
+
+		int32_t py = (int32_t)(y - Clip.originY) * 256;
+		uint16_t spanCount = 0;
+		uint16_t kept = 0;
+
+		for (uint16_t a = 0; a < activeCount; a++) {
+			const lcdPolySegment_t *shape = &active[a];
+			uint16_t i = shape->segment;
+			const lcdPoint_t *p = &points[i];
+			const lcdPoint_t *q = (count > 1) ? &points[i + 1] : p;
+			int32_t x0, x1;
+
+			// Bundle finished, removed from active list
+			if (shape->bottom + Clip.originY + reach < y)
+				continue;
+			if (kept != a)
+				active[kept] = *shape;
+			shape = &active[kept++];
+
+			int32_t px = p->x * 256 + shift, pyf = p->y * 256 + shift;
+			int32_t qx = q->x * 256 + shift, qyf = q->y * 256 + shift;
+
+			// Rectangle of the segment
+			if (p->x != q->x || p->y != q->y) {
+				const int32_t vx[4] = { px + shape->nx, qx + shape->nx, qx - shape->nx, px - shape->nx };
+				const int32_t vy[4] = { pyf + shape->ny, qyf + shape->ny, qyf - shape->ny, pyf - shape->ny };
+				lcdConvexSpan(vx, vy, 4, py, &x0, &x1);
+				if (x0 <= x1) {
+					spans[spanCount].x0 = x0 + Clip.originX;
+					spans[spanCount++].x1 = x1 + Clip.originX;
+				}
+			}
+
+			// Caps
+			if (cap == LCD_CAP_ROUND && (i == 0 || i + 2 == count)) {
+				if (i == 0) {
+					lcdDiscSpan(px, pyf, radius, py, &x0, &x1);
+					if (x0 <= x1) {
+						spans[spanCount].x0 = x0 + Clip.originX;
+						spans[spanCount++].x1 = x1 + Clip.originX;
+					}
+				}
+				if (i + 2 == count) {
+					lcdDiscSpan(qx, qyf, radius, py, &x0, &x1);
+					if (x0 <= x1) {
+						spans[spanCount].x0 = x0 + Clip.originX;
+						spans[spanCount++].x1 = x1 + Clip.originX;
+					}
+				}
+			}
+
+			// Join at the end of the segment
+			if (shape->join == 0)
+				continue;
+			if (shape->join == 1) {
+				lcdDiscSpan(qx, qyf, radius, py, &x0, &x1);
+			} else {
+				int32_t vx[4] = { qx, qx + shape->ax, qx + shape->mx, qx + shape->bx };
+				int32_t vy[4] = { qyf, qyf + shape->ay, qyf + shape->my, qyf + shape->by };
+				if (shape->join == 3) {
+					vx[2] = vx[3];
+					vy[2] = vy[3];
+				}
+				lcdConvexSpan(vx, vy, shape->join, py, &x0, &x1);
+			}
+			if (x0 <= x1) {
+				spans[spanCount].x0 = x0 + Clip.originX;
+				spans[spanCount++].x1 = x1 + Clip.originX;
+			}
+		}
+		activeCount = kept;
+
+		if (spanCount > 0)
+			fillSpans(spans, spanCount, y, color);
+	}
+	return true;
+}
+
+void ILI9341::drawImage(int16_t x, int16_t y, const sImage_t *pBitmap) {
+	LCD_LOCK(*this);
+	writeClippedRect(x + Clip.originX, y + Clip.originY, pBitmap->width, pBitmap->height,
+			(const uint16_t*)pBitmap->pData, pBitmap->bytesPerLine / 2);
+}
+
+void ILI9341::drawImage(int16_t x, int16_t y, const sImage_t *pBitmap, uint16_t key) {
+	LCD_LOCK(*this);
+	x += Clip.originX;
+	y += Clip.originY;
+
+	int16_t top = (y < Clip.y0) ? Clip.y0 - y : 0;
+	int16_t bottom = (y + pBitmap->height - 1 > Clip.y1) ? Clip.y1 - y : pBitmap->height - 1;
+	for (int16_t row = top; row <= bottom; row++) {
+		const uint16_t *line = (const uint16_t*)(pBitmap->pData + row * pBitmap->bytesPerLine);
+		uint16_t px = 0;
+		while (px < pBitmap->width) {
+			while (px < pBitmap->width && line[px] == key)
+				px++;
+			uint16_t start = px;
+			while (px < pBitmap->width && line[px] != key)
+				px++;
+			if (px > start)
+				writeClippedPixels(x + start, y + row, line + start, px - start);
+		}
+	}
+}
+
+void ILI9341::drawImage(int16_t x, int16_t y, const sImage_t *pBitmap, lcdRotation_t rotation) {
+	LCD_LOCK(*this);
+	int16_t sourceX, sourceY;
+
+	if (rotation == LCD_ROTATE_0) {
+		drawImage(x, y, pBitmap);
 		return;
+	}
+
+	beginRotation(x + Clip.originX, y + Clip.originY, pBitmap->width, pBitmap->height, rotation,
+			sourceX, sourceY);
+	writeClippedRect(sourceX, sourceY, pBitmap->width, pBitmap->height,
+			(const uint16_t*)pBitmap->pData, pBitmap->bytesPerLine / 2);
+	endRotation();
+}
 
-	for (int i = 0; i < pBitmap->height; ++i) {
-		drawPixels(x, y + i, (uint16_t*)(pBitmap->pData + i * pBitmap->bytesPerLine),
-				pBitmap->bytesPerLine / (pBitmap->bitsPerPixel / 8));
+void ILI9341::drawImage(int16_t x, int16_t y, const sImageRuns_t *pRuns) {
+	LCD_LOCK(*this);
+	const sImage_t *image = pRuns->image;
+	const uint16_t *runs = pRuns->runs;
+
+	x += Clip.originX;
+	y += Clip.originY;
+
+	int16_t bottom = (y + image->height - 1 > Clip.y1) ? Clip.y1 - y : image->height - 1;
+	for (int16_t row = 0; row <= bottom; row++) {
+		uint16_t count = *runs++;
+		if (y + row >= Clip.y0) {
+			const uint16_t *line = (const uint16_t*)(image->pData + row * image->bytesPerLine);
+			for (uint16_t i = 0; i < count; i++)
+				writeClippedPixels(x + runs[2 * i], y + row, line + runs[2 * i], runs[2 * i + 1]);
+		}
+		runs += 2 * count;
 	}
 }
 
-void ILI9341::drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color, uint16_t bg) {
-	if ((x >= Properties.width) || 			// Clip right
-		(y >= Properties.height) || 		// Clip bottom
-		((x + Font.pFont->Width) < 0) || // Clip left
-		((y + Font.pFont->Height) < 0))  // Clip top
+void ILI9341::drawImageTransformed(const sImage_t *pBitmap, int16_t cx, int16_t cy, int16_t angle,
+		uint16_t scale, lcdSampling_t sampling, uint32_t key) {
+	LCD_LOCK(*this);
+	static uint16_t row[ILI9341_PIXEL_HEIGHT];
+	const uint16_t width = pBitmap->width, height = pBitmap->height;
+	const uint16_t stride = pBitmap->bytesPerLine / 2;
+	const uint16_t *pixels = (const uint16_t*)pBitmap->pData;
+
+	if (scale == 0 || width == 0 || height == 0)
 		return;
 
-	uint8_t fontCoeff = Font.pFont->Height / 8;
-	uint8_t xP = 0;
+	cx += Clip.originX;
+	cy += Clip.originY;
 
-	for (uint8_t i = 0; i < Font.pFont->Height; i++) {
-		uint8_t line;
+	// Inverse mapping, screen to image, in 16.16 fixed point
+	int32_t sine = lcdSin(angle), cosine = lcdSin(angle + 90);
+	int32_t dudx = (cosine * 4 * 256) / scale, dvdx = -(sine * 4 * 256) / scale;
+	int32_t dudy = (sine * 4 * 256) / scale, dvdy = (cosine * 4 * 256) / scale;
 
-		for (uint8_t j = 0; j < fontCoeff; j++) {
-			line = Font.pFont->table[((c - 0x20) * Font.pFont->Height
-					* fontCoeff) + (i * fontCoeff) + j];
+	// Box of the rotated image
+	int32_t extentX = ((abs(cosine) * width + abs(sine) * height) * (int64_t)scale >> 23) + 1;
+	int32_t extentY = ((abs(sine) * width + abs(cosine) * height) * (int64_t)scale >> 23) + 1;
+	int16_t x0 = cx - extentX, y0 = cy - extentY, x1 = cx + extentX, y1 = cy + extentY;
+	if (!clipWindow(x0, y0, x1, y1))
+		return;
 
-			for (uint8_t k = 0; k < 8; k++) {
-				if ((line & 0x80) == 0x80) {
-					drawPixel(x + k + xP, y + i, color);
-				} else if (bg != color) {
-					drawPixel(x + k + xP, y + i, bg);
+	// Even sizes have the center at the top left corner of pixel cx, cy,
+	// so screen pixel centers map to image pixel centers
+	int32_t centerX = (width & 1) ? 0 : 32768, centerY = (height & 1) ? 0 : 32768;
+	int32_t centerU = (int32_t)(((int64_t)centerX * dudx + (int64_t)centerY * dudy) >> 16);
+	int32_t centerV = (int32_t)(((int64_t)centerX * dvdx + (int64_t)centerY * dvdy) >> 16);
+
+	// Bilinear samples between pixel centers
+	int32_t offset = (sampling == LCD_SAMPLE_BILINEAR) ? 32768 : 0;
+	int32_t limitU = width * 65536 - 1, limitV = height * 65536 - 1;
+
+	for (int16_t py = y0; py <= y1; py++) {
+		int64_t left = width * 32768 + (int64_t)(x0 - cx) * dudx + (int64_t)(py - cy) * dudy + centerU;
+		int64_t top = height * 32768 + (int64_t)(x0 - cx) * dvdx + (int64_t)(py - cy) * dvdy + centerV;
+
+		// Columns where the sample is inside the image, no compares per pixel
+		int32_t first, last, a, b;
+		lcdLinearRange(dudx, left, 0, &first, &last);
+		lcdLinearRange(-dudx, limitU - left, 0, &a, &b);
+		first = (a > first) ? a : first;
+		last = (b < last) ? b : last;
+		lcdLinearRange(dvdx, top, 0, &a, &b);
+		first = (a > first) ? a : first;
+		last = (b < last) ? b : last;
+		lcdLinearRange(-dvdx, limitV - top, 0, &a, &b);
+		first = (a > first) ? a : first;
+		last = (b < last) ? b : last;
+		if (first < 0)
+			first = 0;
+		if (last > x1 - x0)
+			last = x1 - x0;
+		if (first > last)
+			continue;
+
+		// Inside the image from here on, 32 bits are enough
+		int32_t u = (int32_t)(left + (int64_t)first * dudx) - offset;
+		int32_t v = (int32_t)(top + (int64_t)first * dvdx) - offset;
+		int32_t start = -1;
+		for (int32_t i = first; i <= last; i++, u += dudx, v += dvdx) {
+			int32_t su = u >> 16, sv = v >> 16;
+			uint16_t color;
+
+			if (sampling == LCD_SAMPLE_BILINEAR) {
+				// Neighbours out of the image repeat the border
+				int32_t u0 = (su < 0) ? 0 : su, v0 = (sv < 0) ? 0 : sv;
+				int32_t u1 = (su + 1 < width) ? su + 1 : width - 1;
+				int32_t v1 = (sv + 1 < height) ? sv + 1 : height - 1;
+				if (u0 >= width)
+					u0 = width - 1;
+				if (v0 >= height)
+					v0 = height - 1;
+				uint32_t leftPair = pixels[v0 * stride + u0] | ((uint32_t)pixels[v1 * stride + u0] << 16);
+				uint32_t rightPair = pixels[v0 * stride + u1] | ((uint32_t)pixels[v1 * stride + u1] << 16);
+				uint32_t nearest = ((u & 0x8000) ? rightPair : leftPair) >> ((v & 0x8000) ? 16 : 0);
+				if ((nearest & 0xFFFF) == key) {
+					color = key;
+				} else {
+					if ((leftPair & 0xFFFF) == key)
+						leftPair = (leftPair & 0xFFFF0000) | (nearest & 0xFFFF);
+					if ((leftPair >> 16) == key)
+						leftPair = (leftPair & 0xFFFF) | (nearest << 16);
+					if ((rightPair & 0xFFFF) == key)
+						rightPair = (rightPair & 0xFFFF0000) | (nearest & 0xFFFF);
+					if ((rightPair >> 16) == key)
+						rightPair = (rightPair & 0xFFFF) | (nearest << 16);
+					// Both rows across in one step, then down
+					uint32_t across = lcdBlendPair(rightPair, leftPair, ((u & 0xFFFF) + 1024) >> 11);
+					color = lcdBlendPair(across >> 16, across & 0xFFFF, ((v & 0xFFFF) + 1024) >> 11);
 				}
-				line <<= 1;
+			} else {
+				color = pixels[sv * stride + su];
 			}
 
-			xP += 8;
+			// Runs of opaque pixels are written as spans
+			if (color != key) {
+				if (start < 0)
+					start = i;
+				row[i - start] = color;
+			} else if (start >= 0) {
+				writeClippedPixels(x0 + start, py, row, i - start);
+				start = -1;
+			}
 		}
-
-		xP = 0;
+		if (start >= 0)
+			writeClippedPixels(x0 + start, py, row, last + 1 - start);
 	}
 }
 
+void ILI9341::blitAlpha(int16_t x, int16_t y, const sImage_t *pBitmap, uint8_t alpha) {
+	LCD_LOCK(*this);
+	if (alpha == 0)
+		return;
+
+	x += Clip.originX;
+	y += Clip.originY;
+
+	// Opaque images are written without reading the background
+	if (alpha == 255)
+		writeClippedRect(x, y, pBitmap->width, pBitmap->height,
+				(const uint16_t*)pBitmap->pData, pBitmap->bytesPerLine / 2);
+	else
+		blendWindow(x, y, x + pBitmap->width - 1, y + pBitmap->height - 1, pBitmap, 0, alpha);
+}
+
+void ILI9341::drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color, uint16_t bg) {
+	LCD_LOCK(*this);
+	drawGlyph(Font.pFont, Font.TextScale, x + Clip.originX, y + Clip.originY, c, color, bg);
+}
+
 void ILI9341::printf(const char *fmt, ...) {
-	static char buf[256];
-	char *p;
+	LCD_LOCK(*this);
 	va_list lst;
 	va_start(lst, fmt);
-	vsprintf(buf, fmt, lst);
+	vsnprintf(lcdPrintBuffer, sizeof(lcdPrintBuffer), fmt, lst);
 	va_end(lst);
-	p = buf;
-	while (*p) {
-		if (*p == '\n') {
-			cursorXY.y += Font.pFont->Height;
-			cursorXY.x = 0;
-		} else if (*p == '\r') {
-			// skip em
-		} else if (*p == '\t') {
-			cursorXY.x += Font.pFont->Width * 4;
-		} else {
-			drawChar(cursorXY.x, cursorXY.y, *p, Font.TextColor,
-					Font.BackColor);
-			cursorXY.x += Font.pFont->Width;
-			if (Font.TextWrap
-					&& (cursorXY.x
-							> (Properties.width - Font.pFont->Width))) {
-				cursorXY.y += Font.pFont->Height;
-				cursorXY.x = 0;
-			}
-		}
-		p++;
-		if (cursorXY.y >= Properties.height) {
-			cursorXY.y = 0;
-		}
-	}
+	printText(lcdPrintBuffer);
+}
+
+void ILI9341::printf(lcdTextState_t *state, const char *fmt, ...) {
+	LCD_LOCK(*this);
+	va_list lst;
+	va_start(lst, fmt);
+	vsnprintf(lcdPrintBuffer, sizeof(lcdPrintBuffer), fmt, lst);
+	va_end(lst);
+	swapTextState(state);
+	printText(lcdPrintBuffer);
+	swapTextState(state);
 }
 
 void ILI9341::clrLine(uint16_t bg) {
-    uint16_t width = Properties.width;
-    uint16_t height = Font.pFont->Height;
-    for(uint16_t y = cursorXY.y; y < (cursorXY.y+height); y++) {
-        drawFastHLine(0, y, width, bg);
-    }
+	LCD_LOCK(*this);
+    fillRect(0, cursorXY.y, Properties.width, charHeight(), bg);
 }
 
 void ILI9341::clrLine() {
+	LCD_LOCK(*this);
     clrLine(Font.BackColor);
 }
 
 void ILI9341::setTextFont(font_t *font) {
+	LCD_LOCK(*this);
 	Font.pFont = font;
 }
 
 void ILI9341::setTextColor(uint16_t textColor, uint16_t bgColor) {
+	LCD_LOCK(*this);
 	Font.TextColor = textColor;
 	Font.BackColor = bgColor;
 }
 
 void ILI9341::setTextWrap(uint8_t width) {
+	LCD_LOCK(*this);
 	Font.TextWrap = width;
 }
 
-void ILI9341::setOrientation(lcdOrientation_t value) {
-	Properties.orientation = value;
-	writeCommand(ILI9341_MEMCONTROL);
+void ILI9341::setTextScale(uint8_t scale) {
+	LCD_LOCK(*this);
+	Font.TextScale = scale ? scale : 1;
+}
 
-	switch (Properties.orientation) {
-	case LCD_ORIENTATION_PORTRAIT:
-		writeData(PortraitConfig);
-		Properties.width = ILI9341_PIXEL_WIDTH;
-		Properties.height = ILI9341_PIXEL_HEIGHT;
-		break;
-	case LCD_ORIENTATION_PORTRAIT_MIRROR:
-		writeData(PortraitMirrorConfig);
-		Properties.width = ILI9341_PIXEL_WIDTH;
-		Properties.height = ILI9341_PIXEL_HEIGHT;
-		break;
-	case LCD_ORIENTATION_LANDSCAPE:
-		writeData(LandscapeConfig);
-		Properties.width = ILI9341_PIXEL_HEIGHT;
-		Properties.height = ILI9341_PIXEL_WIDTH;
-		break;
-	case LCD_ORIENTATION_LANDSCAPE_MIRROR:
-		writeData(LandscapeMirrorConfig);
+lcdTextSize_t ILI9341::measureText(const char *text) {
+	LCD_LOCK(*this);
+	lcdTextSize_t size = { 0, 0 };
+	uint16_t chars = 0;
+
+	if (text == NULL || *text == '\0')
+		return size;
+
+	size.height = charHeight();
+	for (; *text; text++) {
+		if (*text == '\n') {
+			size.height += charHeight();
+			chars = 0;
+		} else if (*text != '\r') {
+			chars++;
+			if (chars * charWidth() > size.width)
+				size.width = chars * charWidth();
+		}
+	}
+	return size;
+}
+
+uint16_t ILI9341::layoutText(const char *text, uint16_t boxWidth, lcdTextAlign_t align,
+		lcdTextLine_t *lines, uint16_t maxLines, lcdTextSize_t *bounds) {
+	LCD_LOCK(*this);
+	lcdTextLine_t line;
+	uint16_t count = 0;
+	uint16_t width = 0;
+
+	while (text != NULL && *text) {
+		text = lcdNextTextLine(charWidth(), text, boxWidth, align, &line);
+		line.y = count * charHeight();
+		if (line.width > width)
+			width = line.width;
+		// Lines beyond the array are still counted, so both modes agree
+		if (lines != NULL && count < maxLines)
+			lines[count] = line;
+		count++;
+	}
+
+	if (bounds != NULL) {
+		bounds->width = width;
+		bounds->height = count * charHeight();
+	}
+	return count;
+}
+
+lcdTextSize_t ILI9341::drawText(const lcdTextState_t *state, int16_t x, int16_t y, uint16_t boxWidth,
+		const char *text, lcdTextAlign_t align, lcdRotation_t rotation) {
+	LCD_LOCK(*this);
+	lcdTextState_t local = *state;
+	lcdTextSize_t size;
+
+	swapTextState(&local);
+	size = drawText(x, y, boxWidth, text, align, rotation);
+	swapTextState(&local);
+	return size;
+}
+
+lcdTextState_t ILI9341::getTextState(void) {
+	LCD_LOCK(*this);
+	lcdTextState_t state = { Font, cursorXY };
+	return state;
+}
+
+void ILI9341::lock(void) {
+#ifdef LCD_THREAD_SAFE
+	BusMutex.lock();
+#endif
+}
+
+void ILI9341::unlock(void) {
+#ifdef LCD_THREAD_SAFE
+	BusMutex.unlock();
+#endif
+}
+
+lcdTextSize_t ILI9341::drawText(int16_t x, int16_t y, uint16_t boxWidth, const char *text,
+		lcdTextAlign_t align, lcdRotation_t rotation) {
+	LCD_LOCK(*this);
+	lcdTextSize_t size = { boxWidth, 0 };
+	lcdTextSize_t bounds;
+	lcdTextLine_t line;
+
+	if (text == NULL)
+		return size;
+	if (boxWidth == 0)
+		size.width = boxWidth = measureText(text).width;
+
+	x += Clip.originX;
+	y += Clip.originY;
+	// The turned box is placed by its corner on screen, so its height is needed first
+	if (rotation != LCD_ROTATE_0) {
+		layoutText(text, boxWidth, align, NULL, 0, &bounds);
+		beginRotation(x, y, boxWidth, bounds.height, rotation, x, y);
+	}
+
+	while (*text) {
+		text = lcdNextTextLine(charWidth(), text, boxWidth, align, &line);
+		line.y = size.height;
+		drawTextLine(x, y, boxWidth, &line, Font.TextColor, Font.BackColor);
+		size.height += charHeight();
+	}
+
+	if (rotation != LCD_ROTATE_0)
+		endRotation();
+	return size;
+}
+
+void ILI9341::setOrientation(lcdOrientation_t value) {
+	LCD_LOCK(*this);
+	Properties.orientation = value;
+	writeCommand(ILI9341_MEMCONTROL);
+
+	switch (Properties.orientation) {
+	case LCD_ORIENTATION_PORTRAIT:
+		MemoryConfig = PortraitConfig;
+		writeData(MemoryConfig);
+		Properties.width = ILI9341_PIXEL_WIDTH;
+		Properties.height = ILI9341_PIXEL_HEIGHT;
+		break;
+	case LCD_ORIENTATION_PORTRAIT_MIRROR:
+		MemoryConfig = PortraitMirrorConfig;
+		writeData(MemoryConfig);
+		Properties.width = ILI9341_PIXEL_WIDTH;
+		Properties.height = ILI9341_PIXEL_HEIGHT;
+		break;
+	case LCD_ORIENTATION_LANDSCAPE:
+		MemoryConfig = LandscapeConfig;
+		writeData(MemoryConfig);
+		Properties.width = ILI9341_PIXEL_HEIGHT;
+		Properties.height = ILI9341_PIXEL_WIDTH;
+		break;
+	case LCD_ORIENTATION_LANDSCAPE_MIRROR:
+		MemoryConfig = LandscapeMirrorConfig;
+		writeData(MemoryConfig);
 		Properties.width = ILI9341_PIXEL_HEIGHT;
 		Properties.height = ILI9341_PIXEL_WIDTH;
 		break;
@@ -698,26 +1585,101 @@ void ILI9341::setOrientation(lcdOrientation_t value) {
 
 	//writeCommand(ILI9341_MEMORYWRITE);
 	setWindow(0, 0, Properties.width - 1, Properties.height - 1);
+	resetClip();
+}
+
+void ILI9341::setScrollArea(uint16_t topFixed, uint16_t bottomFixed) {
+	LCD_LOCK(*this);
+	uint16_t area = ILI9341_PIXEL_HEIGHT - topFixed - bottomFixed;
+	writeCommand(ILI9341_VERTICALSCROLING);
+	writeData(topFixed >> 8);
+	writeData(topFixed & 0xFF);
+	writeData(area >> 8);
+	writeData(area & 0xFF);
+	writeData(bottomFixed >> 8);
+	writeData(bottomFixed & 0xFF);
+}
+
+void ILI9341::setScrollStart(uint16_t line) {
+	LCD_LOCK(*this);
+	writeCommand(ILI9341_VSCROLLSTARTADDRESS);
+	writeData(line >> 8);
+	writeData(line & 0xFF);
+}
+
+bool ILI9341::pushClip(int16_t x, int16_t y, int16_t width, int16_t height) {
+	LCD_LOCK(*this);
+	if (ClipDepth >= LCD_CLIP_STACK_SIZE)
+		return false;
+	ClipStack[ClipDepth++] = Clip;
+
+	// The new clip is inside the current one
+	int16_t x0 = x + Clip.originX;
+	int16_t y0 = y + Clip.originY;
+	int16_t x1 = x0 + width - 1;
+	int16_t y1 = y0 + height - 1;
+	if (x0 > Clip.x0)
+		Clip.x0 = x0;
+	if (y0 > Clip.y0)
+		Clip.y0 = y0;
+	if (x1 < Clip.x1)
+		Clip.x1 = x1;
+	if (y1 < Clip.y1)
+		Clip.y1 = y1;
+	return true;
+}
+
+bool ILI9341::pushViewport(int16_t x, int16_t y, int16_t width, int16_t height) {
+	LCD_LOCK(*this);
+	if (!pushClip(x, y, width, height))
+		return false;
+	Clip.originX += x;
+	Clip.originY += y;
+	return true;
+}
+
+void ILI9341::popClip(void) {
+	LCD_LOCK(*this);
+	if (ClipDepth > 0)
+		Clip = ClipStack[--ClipDepth];
+}
+
+void ILI9341::resetClip(void) {
+	LCD_LOCK(*this);
+	ClipDepth = 0;
+	Clip.x0 = 0;
+	Clip.y0 = 0;
+	Clip.x1 = Properties.width - 1;
+	Clip.y1 = Properties.height - 1;
+	Clip.originX = 0;
+	Clip.originY = 0;
+}
+
+lcdClip_t ILI9341::getClip(void) {
+	LCD_LOCK(*this);
+	return Clip;
 }
 
 void ILI9341::home(void) {
+	LCD_LOCK(*this);
 	cursorXY.x = 0;
 	cursorXY.y = 0;
 	setWindow(0, 0, Properties.width - 1, Properties.height - 1);
 }
 
 void ILI9341::setCursor(uint16_t x, uint16_t y) {
+	LCD_LOCK(*this);
 	cursorXY.x = x;
 	cursorXY.y = y;
 	setWindow(x, y, x, y);
 }
 
 uint16_t ILI9341::getColumn(uint16_t coll) {
-    return (coll * (Font.pFont->Width));
+    return (coll * (charWidth()));
 }
 
 uint16_t ILI9341::getLine(uint16_t line) {
-    return (line * (Font.pFont->Height));
+    return (line * (charHeight()));
 }
 
 void ILI9341::backlightBright(uint8_t bright) {
@@ -732,28 +1694,34 @@ uint8_t ILI9341::backlightBright() {
 }
 
 void ILI9341::inversionOff(void) {
+	LCD_LOCK(*this);
 	writeCommand(ILI9341_INVERTOFF);
 }
 
 void ILI9341::inversionOn(void) {
+	LCD_LOCK(*this);
 	writeCommand(ILI9341_INVERTON);
 }
 
 void ILI9341::displayOff(void) {
+	LCD_LOCK(*this);
 	writeCommand(ILI9341_DISPLAYOFF);
 	backlightBright(0);
 }
 
 void ILI9341::displayOn(void) {
+	LCD_LOCK(*this);
 	writeCommand(ILI9341_DISPLAYON);
 	backlightBright(_bright);
 }
 
 void ILI9341::tearingOff(void) {
+	LCD_LOCK(*this);
 	writeCommand(ILI9341_TEARINGEFFECTOFF);
 }
 
 void ILI9341::tearingOn(bool m) {
+	LCD_LOCK(*this);
 	writeCommand(ILI9341_TEARINGEFFECTON);
 	writeData(m);
 }
@@ -767,6 +1735,7 @@ uint16_t ILI9341::getHeight(void) {
 }
 
 uint16_t ILI9341::getControllerID(void) {
+	LCD_LOCK(*this);
 	uint16_t id;
 	writeCommand(ILI9341_READID4);
 	id = readData();
@@ -788,31 +1757,99 @@ lcdProperties_t ILI9341::getProperties(void) {
 	return Properties;
 }
 
-uint16_t ILI9341::readPixel(uint16_t x, uint16_t y) {
-	uint16_t temp[3];
-	// Clip
-	if ((x < 0) || (y < 0) || (x >= Properties.width) || (y >= Properties.height))
-		return 0;
+uint16_t ILI9341::readPixel(int16_t x, int16_t y) {
+	LCD_LOCK(*this);
+	uint16_t color = 0;
+	readRect(x, y, 1, 1, &color);
+	return color;
+}
 
-	writeCommand(ILI9341_COLADDRSET);
-	writeData((x >> 8) & 0xFF);
-	writeData(x & 0xFF);
+void ILI9341::readRect(int16_t x, int16_t y, int16_t width, int16_t height, uint16_t *buffer) {
+	LCD_LOCK(*this);
+	if (width <= 0 || height <= 0)
+		return;
 
-	writeCommand(ILI9341_PAGEADDRSET);
-	writeData((y >> 8) & 0xFF);
-	writeData(y & 0xFF);
+	readClippedRect(x + Clip.originX, y + Clip.originY, width, height, buffer, width);
+}
+
+bool ILI9341::readWindow(int16_t x, int16_t y, int16_t width, int16_t height) {
+	LCD_LOCK(*this);
+	if (width <= 0 || height <= 0)
+		return false;
+
+	x += Clip.originX;
+	y += Clip.originY;
+	int16_t x0 = x, y0 = y, x1 = x + width - 1, y1 = y + height - 1;
+	if (!clipWindow(x0, y0, x1, y1) || x0 != x || y0 != y || x1 != x + width - 1 || y1 != y + height - 1)
+		return false;
 
-	writeCommand(ILI9341_MEMORYREAD);
+	setAddress(x0, y0, x1, y1);
+	ReadStarted = false;
+	return true;
+}
+
+void ILI9341::readContinue(uint16_t *buffer, uint32_t count) {
+	LCD_LOCK(*this);
+	if (count == 0)
+		return;
+
+	// The first part starts the window, the next ones go on from the last pixel read
+	readPixels(buffer, count, 0, 0, ReadStarted ? ILI9341_READMEMCONTINUE : ILI9341_MEMORYREAD);
+	ReadStarted = true;
+}
+
+void ILI9341::beginCapture(lcdCapture_t *capture, lcdCaptureWriter_t writer, void *context, uint16_t bandRows) {
+	LCD_LOCK(*this);
+	const uint8_t header[8] = { 'L', 'C', 'D', 'S',
+			(uint8_t)(Properties.width & 0xFF), (uint8_t)(Properties.width >> 8),
+			(uint8_t)(Properties.height & 0xFF), (uint8_t)(Properties.height >> 8) };
+
+	capture->writer = writer;
+	capture->context = context;
+	capture->bandRows = bandRows ? bandRows : 1;
+	capture->row = 0;
+	capture->failed = false;
+	capture->length = 0;
+	lcdCapturePut(capture, header, sizeof(header));
+}
+
+bool ILI9341::captureBand(lcdCapture_t *capture) {
+	LCD_LOCK(*this);
+	static uint16_t pixels[ILI9341_PIXEL_HEIGHT];
+
+	if (capture->failed || capture->row >= Properties.height)
+		return false;
+
+	uint16_t last = capture->row + capture->bandRows - 1;
+	if (last >= Properties.height)
+		last = Properties.height - 1;
+
+	// One window for the band, the rows after the first continue the read
+	setAddress(0, capture->row, Properties.width - 1, last);
+	for (uint16_t row = capture->row; row <= last && !capture->failed; row++) {
+		readPixels(pixels, Properties.width, Properties.width, Properties.width,
+				(row == capture->row) ? ILI9341_MEMORYREAD : ILI9341_READMEMCONTINUE);
+		lcdCaptureRow(capture, pixels, Properties.width);
+	}
+	capture->row = last + 1;
+
+	if (capture->row >= Properties.height)
+		lcdCaptureFlush(capture);
+	return !capture->failed && capture->row < Properties.height;
+}
 
-	temp[0] = readData(); // dummy read
-	temp[1] = readData();
-	temp[2] = readData();
+bool ILI9341::captureScreen(lcdCaptureWriter_t writer, void *context) {
+	LCD_LOCK(*this);
+	lcdCapture_t capture;
 
-	return color565((temp[1] >> 8) & 0xFF, temp[1] & 0xFF,
-			(temp[2] >> 8) & 0xFF);
+	beginCapture(&capture, writer, context);
+	while (captureBand(&capture))
+		;
+	return !capture.failed;
 }
 
 void ILI9341::reset(void) {
+	LCD_LOCK(*this);
     if(_rst.is_connected()) {
         _rst = 1;
         ThisThread::sleep_for(10ms);
@@ -830,32 +1867,543 @@ void ILI9341::reset(void) {
 /* --- Protected methods --- */
 
 void ILI9341::setWindow(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
+	setAddress(x0, y0, x1, y1);
+	writeCommand(ILI9341_MEMORYWRITE);
+}
+
+void ILI9341::setColumns(uint16_t x0, uint16_t x1) {
 	writeCommand(ILI9341_COLADDRSET);
 	writeData((x0 >> 8) & 0xFF);
 	writeData(x0 & 0xFF);
 	writeData((x1 >> 8) & 0xFF);
 	writeData(x1 & 0xFF);
+}
+
+void ILI9341::setPages(uint16_t y0, uint16_t y1) {
 	writeCommand(ILI9341_PAGEADDRSET);
 	writeData((y0 >> 8) & 0xFF);
 	writeData(y0 & 0xFF);
 	writeData((y1 >> 8) & 0xFF);
 	writeData(y1 & 0xFF);
-	writeCommand(ILI9341_MEMORYWRITE);
+}
+
+void ILI9341::setAddress(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
+	setColumns(x0, x1);
+	setPages(y0, y1);
+}
+
+void ILI9341::readPixels(uint16_t *buffer, uint32_t count, uint16_t columns, uint16_t stride, uint8_t command) {
+	// Pixels come as 6 bits per channel, 3 words for 2 pixels: R1 G1, B1 R2, G2 B2
+	uint16_t column = 0;
+
+	writeCommand(command);
+	readData(); // dummy read
+
+	while (count >= 2) {
+		uint16_t rg = readData();
+		uint16_t br = readData();
+		uint16_t gb = readData();
+		*buffer++ = ((rg & 0xF800)) | ((rg & 0x00FC) << 3) | (br >> 11);
+		if (++column == columns) {
+			buffer += stride - columns;
+			column = 0;
+		}
+		*buffer++ = ((br & 0x00F8) << 8) | ((gb & 0xFC00) >> 5) | ((gb & 0x00F8) >> 3);
+		if (++column == columns) {
+			buffer += stride - columns;
+			column = 0;
+		}
+		count -= 2;
+	}
+	if (count) {
+		uint16_t rg = readData();
+		uint16_t br = readData();
+		*buffer = ((rg & 0xF800)) | ((rg & 0x00FC) << 3) | (br >> 11);
+	}
+}
+
+void ILI9341::writePixel(int16_t x, int16_t y, uint16_t color) {
+	if ((x < Clip.x0) || (y < Clip.y0) || (x > Clip.x1) || (y > Clip.y1))
+		return;
+
+	setWindow(x, y, x, y);
+	writeData(color);
+}
+
+void ILI9341::printText(const char *text) {
+	const char *p = text;
+	while (*p) {
+		if (*p == '\n') {
+			cursorXY.y += charHeight();
+			cursorXY.x = 0;
+		} else if (*p == '\r') {
+			// skip em
+		} else if (*p == '\t') {
+			cursorXY.x += charWidth() * 4;
+		} else {
+			// Word wrap, a word that don't fit goes whole to next line
+			if (Font.TextWrap && cursorXY.x > 0 && *p != ' '
+					&& (p == text || p[-1] == ' ' || p[-1] == '\t')) {
+				uint16_t length = 0;
+				while (p[length] && p[length] != ' ' && p[length] != '\t'
+						&& p[length] != '\r' && p[length] != '\n')
+					length++;
+				if (cursorXY.x + length * charWidth() > Properties.width) {
+					cursorXY.y += charHeight();
+					cursorXY.x = 0;
+				}
+			}
+			drawGlyph(Font.pFont, Font.TextScale, cursorXY.x + Clip.originX, cursorXY.y + Clip.originY, *p,
+					Font.TextColor, Font.BackColor);
+			cursorXY.x += charWidth();
+			if (Font.TextWrap
+					&& (cursorXY.x
+							> (Properties.width - charWidth()))) {
+				cursorXY.y += charHeight();
+				cursorXY.x = 0;
+			}
+		}
+		p++;
+		if (cursorXY.y >= Properties.height) {
+			cursorXY.y = 0;
+		}
+	}
+}
+
+void ILI9341::swapTextState(lcdTextState_t *state) {
+	lcdFontProperties_t font = Font;
+	lcdCursorPos_t cursor = cursorXY;
+	Font = state->font;
+	cursorXY = state->cursor;
+	state->font = font;
+	state->cursor = cursor;
+}
+
+void ILI9341::drawGlyph(const font_t *font, uint8_t scale, int16_t x, int16_t y, uint8_t c,
+		uint16_t color, uint16_t bg) {
+	int16_t x1 = x + font->Width * scale - 1;
+	int16_t y1 = y + font->Height * scale - 1;
+
+	if ((x > Clip.x1) || 		// Clip right
+		(y > Clip.y1) || 		// Clip bottom
+		(x1 < Clip.x0) || 		// Clip left
+		(y1 < Clip.y0))  		// Clip top
+		return;
+
+	// Transparent background, only the runs of set bits are drawn
+	if (bg == color) {
+		for (uint16_t row = 0; row < font->Height; row++) {
+			const uint8_t *bits = lcdGlyphRow(font, c, row);
+			int16_t top = y + row * scale;
+			for (uint16_t k = 0; k < font->Width; k++) {
+				if (!(bits[k >> 3] & (0x80 >> (k & 7))))
+					continue;
+				uint16_t start = k;
+				while (k + 1 < font->Width && (bits[(k + 1) >> 3] & (0x80 >> ((k + 1) & 7))))
+					k++;
+				fillWindow(x + start * scale, top, x + (k + 1) * scale - 1, top + scale - 1, color);
+			}
+		}
+		return;
+	}
+
+	// One window for the glyph, each row of the font is repeated scale times
+	int16_t x0 = x, y0 = y;
+	clipWindow(x0, y0, x1, y1);
+
+	setWindow(x0, y0, x1, y1);
+	for (int16_t py = y0; py <= y1; py++) {
+		int16_t px = x;
+		writeGlyphRow(font, scale, lcdGlyphRow(font, c, (py - y) / scale), px, x0, x1, color, bg);
+	}
+}
+
+bool ILI9341::clipWindow(int16_t &x0, int16_t &y0, int16_t &x1, int16_t &y1) {
+	if (x0 < Clip.x0)
+		x0 = Clip.x0;
+	if (y0 < Clip.y0)
+		y0 = Clip.y0;
+	if (x1 > Clip.x1)
+		x1 = Clip.x1;
+	if (y1 > Clip.y1)
+		y1 = Clip.y1;
+	return (x0 <= x1) && (y0 <= y1);
+}
+
+void ILI9341::fillWindow(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+	if (!clipWindow(x0, y0, x1, y1))
+		return;
+
+	setWindow(x0, y0, x1, y1);
+	writeColor(color, (uint32_t)(x1 - x0 + 1) * (y1 - y0 + 1));
+}
+
+void ILI9341::writeClippedPixels(int16_t x, int16_t y, const uint16_t *data, uint16_t length) {
+	int16_t x0 = x, y0 = y;
+	int16_t x1 = x + length - 1, y1 = y;
+	if (!clipWindow(x0, y0, x1, y1))
+		return;
+
+	setWindow(x0, y0, x1, y1);
+	data += x0 - x;
+	for (int16_t px = x0; px <= x1; px++) {
+		writeData(*data++);
+	}
+}
+
+void ILI9341::writeClippedRect(int16_t x, int16_t y, int16_t width, int16_t height, const uint16_t *data, uint16_t stride) {
+	int16_t x0 = x, y0 = y;
+	int16_t x1 = x + width - 1, y1 = y + height - 1;
+	if (width <= 0 || height <= 0 || !clipWindow(x0, y0, x1, y1))
+		return;
+
+	// One window for the visible part, each row streams only its visible pixels
+	setWindow(x0, y0, x1, y1);
+	for (int16_t row = y0; row <= y1; row++) {
+		const uint16_t *line = data + (row - y) * stride + (x0 - x);
+		for (int16_t col = x0; col <= x1; col++) {
+			writeData(*line++);
+		}
+	}
+}
+
+void ILI9341::readClippedRect(int16_t x, int16_t y, int16_t width, int16_t height, uint16_t *buffer, uint16_t stride) {
+	int16_t x0 = x, y0 = y;
+	int16_t x1 = x + width - 1, y1 = y + height - 1;
+	if (width <= 0 || height <= 0 || !clipWindow(x0, y0, x1, y1))
+		return;
+
+	setAddress(x0, y0, x1, y1);
+	buffer += (y0 - y) * stride + (x0 - x);
+	readPixels(buffer, (uint32_t)(x1 - x0 + 1) * (y1 - y0 + 1), x1 - x0 + 1, stride, ILI9341_MEMORYREAD);
+}
+
+void ILI9341::writeGlyphRow(const font_t *font, uint8_t scale, const uint8_t *bits,
+		int16_t &px, int16_t x0, int16_t x1, uint16_t color, uint16_t bg) {
+	const uint16_t width = font->Width;
+	uint16_t k = 0;
+
+	// Consecutive bits with same value are sent as one run
+	while (k < width) {
+		uint8_t on = bits[k >> 3] & (0x80 >> (k & 7));
+		uint16_t n = 1;
+		while (k + n < width && !(bits[(k + n) >> 3] & (0x80 >> ((k + n) & 7))) == !on)
+			n++;
+		writeClippedRun(px, n * scale, on ? color : bg, x0, x1);
+		k += n;
+	}
+}
+
+void ILI9341::writeClippedRun(int16_t &px, int16_t length, uint16_t color, int16_t x0, int16_t x1) {
+	int16_t start = px < x0 ? x0 : px;
+	int16_t end = px + length - 1;
+
+	if (end > x1)
+		end = x1;
+	if (start <= end)
+		writeColor(color, end - start + 1);
+	px += length;
+}
+
+void ILI9341::blendWindow(int16_t x, int16_t y, int16_t x1, int16_t y1, const sImage_t *image, uint16_t color, uint8_t alpha) {
+	static uint16_t row[ILI9341_PIXEL_HEIGHT];
+	int16_t x0 = x, y0 = y;
+	if (!clipWindow(x0, y0, x1, y1))
+		return;
+
+	uint16_t columns = x1 - x0 + 1;
+	uint32_t weight = (alpha + 4) >> 3;
+	uint32_t pair = color | ((uint32_t)color << 16);
+
+	for (int16_t py = y0; py <= y1; py++) {
+		// Read and write back through the same one row window
+		setAddress(x0, py, x1, py);
+		readPixels(row, columns, columns, columns, ILI9341_MEMORYREAD);
+
+		const uint16_t *source = NULL;
+		if (image)
+			source = (const uint16_t*)(image->pData + (py - y) * image->bytesPerLine) + (x0 - x);
+
+		uint16_t px = 0;
+		for (; px + 1 < columns; px += 2) {
+			if (source)
+				pair = source[px] | ((uint32_t)source[px + 1] << 16);
+			uint32_t blended = lcdBlendPair(pair, row[px] | ((uint32_t)row[px + 1] << 16), weight);
+			row[px] = blended;
+			row[px + 1] = blended >> 16;
+		}
+		if (px < columns) {
+			if (source)
+				pair = source[px];
+			row[px] = lcdBlendPair(pair, row[px], weight);
+		}
+
+		writeCommand(ILI9341_MEMORYWRITE);
+		for (px = 0; px < columns; px++)
+			writeData(row[px]);
+	}
+}
+
+void ILI9341::fillSpans(lcdSpan_t *spans, uint16_t count, int16_t y, uint16_t color) {
+	// Sort by start, overlapping or touching spans are merged in one window
+	for (uint16_t i = 1; i < count; i++) {
+		lcdSpan_t span = spans[i];
+		uint16_t j = i;
+		for (; j > 0 && spans[j - 1].x0 > span.x0; j--)
+			spans[j] = spans[j - 1];
+		spans[j] = span;
+	}
+
+	lcdSpan_t run = spans[0];
+	for (uint16_t i = 1; i < count; i++) {
+		if (spans[i].x0 <= run.x1 + 1) {
+			if (spans[i].x1 > run.x1)
+				run.x1 = spans[i].x1;
+		} else {
+			fillWindow(run.x0, y, run.x1, y, color);
+			run = spans[i];
+		}
+	}
+	fillWindow(run.x0, y, run.x1, y, color);
+}
+
+void ILI9341::drawEllipseRows(int16_t x0, int16_t y0, uint16_t radiusX, uint16_t radiusY, uint16_t color, bool fill) {
+	// Pixel centers inside the ellipse grown by half a pixel:
+	// 4 * b * x^2 + 4 * a * y^2 <= a * b, with a = (2 * rx + 1)^2 and b = (2 * ry + 1)^2
+	const int64_t a = (int64_t)(2 * radiusX + 1) * (2 * radiusX + 1);
+	const int64_t b = (int64_t)(2 * radiusY + 1) * (2 * radiusY + 1);
+	int64_t error = 4 * b * radiusX * radiusX - a * b;
+	int16_t x = radiusX;
+
+	// Half width of each row, stepping x in as y goes out
+	int16_t width = x;
+	for (int16_t y = 0; y <= radiusY; y++) {
+		int16_t next = -1;
+		if (y < radiusY) {
+			error += 4 * a * (2 * y + 1);
+			while (error > 0) {
+				error -= 4 * b * (2 * x - 1);
+				x--;
+			}
+			next = x;
+		}
+
+		// Outline rows are runs from the width of the next row out
+		int16_t inner = fill ? 0 : next + 1;
+		if (inner > width)
+			inner = width;
+		if (inner <= 0) {
+			fillWindow(x0 - width, y0 + y, x0 + width, y0 + y, color);
+			if (y > 0)
+				fillWindow(x0 - width, y0 - y, x0 + width, y0 - y, color);
+		} else {
+			fillWindow(x0 - width, y0 + y, x0 - inner, y0 + y, color);
+			fillWindow(x0 + inner, y0 + y, x0 + width, y0 + y, color);
+			if (y > 0) {
+				fillWindow(x0 - width, y0 - y, x0 - inner, y0 - y, color);
+				fillWindow(x0 + inner, y0 - y, x0 + width, y0 - y, color);
+			}
+		}
+		width = next;
+	}
+}
+
+void ILI9341::fillSector(int16_t x0, int16_t y0, uint16_t innerRadius, uint16_t outerRadius,
+		int16_t start, int16_t end, uint16_t color) {
+	int32_t sweep = (int32_t)end - start;
+	if (sweep <= 0 || outerRadius == 0)
+		return;
+
+	// Rays of start and end, trigonometry only here
+	const float rad = 3.14159265f / 180.0f;
+	int32_t sx = (int32_t)lroundf(cosf(start * rad) * 16384), sy = (int32_t)lroundf(sinf(start * rad) * 16384);
+	int32_t ex = (int32_t)lroundf(cosf(end * rad) * 16384), ey = (int32_t)lroundf(sinf(end * rad) * 16384);
+
+	// Pixel centers up to half a pixel outside the radius belong to the ring
+	int32_t outer = (int32_t)outerRadius * outerRadius + outerRadius;
+	int32_t inner = innerRadius ? (int32_t)innerRadius * innerRadius + innerRadius : -1;
+	int16_t top = y0 - outerRadius, bottom = y0 + outerRadius;
+	if (top < Clip.y0)
+		top = Clip.y0;
+	if (bottom > Clip.y1)
+		bottom = Clip.y1;
+
+	for (int16_t y = top; y <= bottom; y++) {
+		int32_t dy = y - y0;
+		int32_t dy2 = dy * dy;
+		if (dy2 > outer)
+			continue;
+
+		// Ring in the scanline, one or two pieces
+		int32_t ring[2][2];
+		uint8_t pieces = 1;
+		int32_t xo = lcdSqrt(outer - dy2);
+		if (dy2 <= inner) {
+			int32_t xi = lcdSqrt(inner - dy2);
+			ring[0][0] = -xo;
+			ring[0][1] = -xi - 1;
+			ring[1][0] = xi + 1;
+			ring[1][1] = xo;
+			pieces = 2;
+		} else {
+			ring[0][0] = -xo;
+			ring[0][1] = xo;
+		}
+
+		// Sector in the scanline: after the start ray and before the end ray,
+		// both for sweeps up to 180 degrees, either one above
+		int32_t sector[2][2];
+		uint8_t ranges = 2;
+		if (sweep >= 360) {
+			sector[0][0] = INT16_MIN;
+			sector[0][1] = INT16_MAX;
+			ranges = 1;
+		} else {
+			lcdLinearRange(-sy, (int64_t)sx * dy, 0, &sector[0][0], &sector[0][1]);
+			lcdLinearRange(ey, -(int64_t)ex * dy, 1, &sector[1][0], &sector[1][1]);
+			if (sweep <= 180) {
+				if (sector[1][0] > sector[0][0])
+					sector[0][0] = sector[1][0];
+				if (sector[1][1] < sector[0][1])
+					sector[0][1] = sector[1][1];
+				ranges = 1;
+			}
+		}
+
+		lcdSpan_t spans[4];
+		uint8_t spanCount = 0;
+		for (uint8_t i = 0; i < pieces; i++) {
+			for (uint8_t j = 0; j < ranges; j++) {
+				int32_t a = (ring[i][0] > sector[j][0]) ? ring[i][0] : sector[j][0];
+				int32_t b = (ring[i][1] < sector[j][1]) ? ring[i][1] : sector[j][1];
+				if (a <= b) {
+					spans[spanCount].x0 = x0 + a;
+					spans[spanCount++].x1 = x0 + b;
+				}
+			}
+		}
+		if (spanCount > 0)
+			fillSpans(spans, spanCount, y, color);
+	}
+}
+
+void ILI9341::drawTextLine(int16_t x, int16_t y, uint16_t boxWidth, const lcdTextLine_t *line,
+		uint16_t color, uint16_t bg) {
+	const font_t *font = Font.pFont;
+	int16_t top = y + line->y;
+
+	// Transparent text can't be streamed, the background must be kept
+	if (bg == color) {
+		for (uint16_t i = 0; i < line->length; i++)
+			drawGlyph(font, Font.TextScale, x + line->x + i * charWidth(), top, line->text[i], color, bg);
+		return;
+	}
+
+	// Clip the window, glyphs out of it are skipped
+	int16_t x0 = x, y0 = top;
+	int16_t x1 = x + boxWidth - 1;
+	int16_t y1 = top + charHeight() - 1;
+	if (!clipWindow(x0, y0, x1, y1))
+		return;
+
+	setWindow(x0, y0, x1, y1);
+	for (int16_t row = y0; row <= y1; row++) {
+		int16_t px = x;
+
+		// Left padding, glyphs and right padding in the same stream
+		writeClippedRun(px, line->x, bg, x0, x1);
+		for (uint16_t i = 0; i < line->length; i++)
+			writeGlyphRow(font, Font.TextScale, lcdGlyphRow(font, line->text[i], (row - top) / Font.TextScale),
+					px, x0, x1, color, bg);
+		writeClippedRun(px, x + boxWidth - px, bg, x0, x1);
+	}
+}
+
+void ILI9341::beginRotation(int16_t x, int16_t y, int16_t width, int16_t height, lcdRotation_t rotation,
+		int16_t &sourceX, int16_t &sourceY) {
+	const uint8_t scanBits = ILI9341_MADCTL_MY | ILI9341_MADCTL_MX | ILI9341_MADCTL_MV;
+	int16_t column[3], row[3];
+	int16_t ax[3], ay[3];
+	uint8_t config = MemoryConfig;
+
+	// Panel positions of the source pixels (0, 0), (1, 0) and (0, 1) once turned
+	for (uint8_t i = 0; i < 3; i++) {
+		int16_t sx = (i == 1), sy = (i == 2);
+		int16_t dx = sx, dy = sy;
+		switch (rotation) {
+		case LCD_ROTATE_90:
+			dx = height - 1 - sy;
+			dy = sx;
+			break;
+		case LCD_ROTATE_180:
+			dx = width - 1 - sx;
+			dy = height - 1 - sy;
+			break;
+		case LCD_ROTATE_270:
+			dx = sy;
+			dy = width - 1 - sx;
+			break;
+		default:
+			break;
+		}
+		lcdAddressToPanel(MemoryConfig, x + dx, y + dy, &column[i], &row[i]);
+	}
+
+	// One of the eight scan orders steps along the source rows and columns
+	for (uint8_t k = 0; k < 8; k++) {
+		config = (MemoryConfig & ~scanBits) | ((k & 1) ? ILI9341_MADCTL_MX : 0)
+				| ((k & 2) ? ILI9341_MADCTL_MY : 0) | ((k & 4) ? ILI9341_MADCTL_MV : 0);
+		for (uint8_t i = 0; i < 3; i++)
+			lcdPanelToAddress(config, column[i], row[i], &ax[i], &ay[i]);
+		if (ax[1] == ax[0] + 1 && ay[1] == ay[0] && ax[2] == ax[0] && ay[2] == ay[0] + 1)
+			break;
+	}
+	sourceX = ax[0];
+	sourceY = ay[0];
+
+	// The clip is moved to the new address space, the drawing is done in absolute coordinates
+	RotationClip = Clip;
+	lcdAddressToPanel(MemoryConfig, Clip.x0, Clip.y0, &column[0], &row[0]);
+	lcdAddressToPanel(MemoryConfig, Clip.x1, Clip.y1, &column[1], &row[1]);
+	lcdPanelToAddress(config, column[0], row[0], &ax[0], &ay[0]);
+	lcdPanelToAddress(config, column[1], row[1], &ax[1], &ay[1]);
+	Clip.x0 = (ax[0] < ax[1]) ? ax[0] : ax[1];
+	Clip.x1 = (ax[0] < ax[1]) ? ax[1] : ax[0];
+	Clip.y0 = (ay[0] < ay[1]) ? ay[0] : ay[1];
+	Clip.y1 = (ay[0] < ay[1]) ? ay[1] : ay[0];
+	// Sorting the corners would turn an empty clip into a real rectangle
+	if (RotationClip.x0 > RotationClip.x1 || RotationClip.y0 > RotationClip.y1) {
+		Clip.x0 = 0;
+		Clip.x1 = -1;
+	}
+	Clip.originX = 0;
+	Clip.originY = 0;
+
+	writeCommand(ILI9341_MEMCONTROL);
+	writeData(config);
+}
+
+void ILI9341::endRotation(void) {
+	writeCommand(ILI9341_MEMCONTROL);
+	writeData(MemoryConfig);
+	Clip = RotationClip;
 }
 
 int  ILI9341::_putc(int c) {
+	LCD_LOCK(*this);
     if (c == '\n') {
-        cursorXY.y += Font.pFont->Height;
+        cursorXY.y += charHeight();
         cursorXY.x = 0;
     } else if (c == '\r') {
         // skip em
     } else if (c == '\t') {
-		cursorXY.x += Font.pFont->Width * 4;
+		cursorXY.x += charWidth() * 4;
     } else {
-        drawChar(cursorXY.x, cursorXY.y, c, Font.TextColor, Font.BackColor);
-        cursorXY.x += Font.pFont->Width;
-        if (Font.TextWrap && (cursorXY.x > (Properties.width - Font.pFont->Width))) {
-            cursorXY.y += Font.pFont->Height;
+        drawGlyph(Font.pFont, Font.TextScale, cursorXY.x + Clip.originX, cursorXY.y + Clip.originY, c,
+        		Font.TextColor, Font.BackColor);
+        cursorXY.x += charWidth();
+        if (Font.TextWrap && (cursorXY.x > (Properties.width - charWidth()))) {
+            cursorXY.y += charHeight();
             cursorXY.x = 0;
         }
     }
@@ -866,6 +2414,46 @@ int ILI9341::_getc() {
     return -1;
 }
 
+/* --- Functions --- */
+
+const uint8_t *lcdGlyphRow(const font_t *font, uint8_t c, uint16_t row) {
+	uint8_t bytesPerRow = (font->Width + 7) / 8;
+	// Fonts start at space and have 95 characters
+	if (c < 0x20 || c > 0x7E)
+		c = ' ';
+	return &font->table[((c - 0x20) * font->Height + row) * bytesPerRow];
+}
+
+uint32_t lcdImageRuns(const sImage_t *image, uint16_t key, uint16_t *runs, uint32_t size) {
+	uint32_t used = 0;
+
+	for (uint16_t row = 0; row < image->height; row++) {
+		const uint16_t *line = (const uint16_t*)(image->pData + row * image->bytesPerLine);
+		uint32_t counter = used++;
+		uint16_t count = 0;
+		uint16_t px = 0;
+
+		if (used > size)
+			return 0;
+		while (px < image->width) {
+			while (px < image->width && line[px] == key)
+				px++;
+			uint16_t start = px;
+			while (px < image->width && line[px] != key)
+				px++;
+			if (px > start) {
+				if (used + 2 > size)
+					return 0;
+				runs[used++] = start;
+				runs[used++] = px - start;
+				count++;
+			}
+		}
+		runs[counter] = count;
+	}
+	return used;
+}
+
 /* --- Static functions --- */
 static unsigned char lcdBuildMemoryAccessControlConfig(
 		MemoryAccessControlRefreshOrder_t rowAddressOrder,
@@ -892,6 +2480,315 @@ static unsigned char lcdBuildMemoryAccessControlConfig(
 
 }
 
+static int lcdComparePixels(const void *a, const void *b) {
+	const lcdPixel_t *p = (const lcdPixel_t*)a;
+	const lcdPixel_t *q = (const lcdPixel_t*)b;
+	if (p->y != q->y)
+		return p->y - q->y;
+	return p->x - q->x;
+}
+
+static void lcdAddressToPanel(uint8_t config, int16_t x, int16_t y, int16_t *column, int16_t *row) {
+	if (config & ILI9341_MADCTL_MV)
+		swap(x, y);
+	*column = (config & ILI9341_MADCTL_MX) ? ILI9341_PIXEL_WIDTH - 1 - x : x;
+	*row = (config & ILI9341_MADCTL_MY) ? ILI9341_PIXEL_HEIGHT - 1 - y : y;
+}
+
+static void lcdPanelToAddress(uint8_t config, int16_t column, int16_t row, int16_t *x, int16_t *y) {
+	if (config & ILI9341_MADCTL_MX)
+		column = ILI9341_PIXEL_WIDTH - 1 - column;
+	if (config & ILI9341_MADCTL_MY)
+		row = ILI9341_PIXEL_HEIGHT - 1 - row;
+	if (config & ILI9341_MADCTL_MV)
+		swap(column, row);
+	*x = column;
+	*y = row;
+}
+
+static int16_t lcdSegmentTop(const lcdPoint_t *points, uint16_t count, uint16_t segment) {
+	if (count > 1 && points[segment + 1].y < points[segment].y)
+		return points[segment + 1].y;
+	return points[segment].y;
+}
+
+static int32_t lcdFloorDiv(int64_t a, int64_t b) {
+	int64_t q = a / b;
+	if ((a % b != 0) && ((a < 0) != (b < 0)))
+		q--;
+	return (int32_t)q;
+}
+
+static void lcdPolySegmentStart(lcdPolySegment_t *shape, const lcdPoint_t *points, uint16_t count,
+		uint16_t segment, uint16_t width, lcdLineJoin_t join) {
+	const float half = width / 2.0f;
+	const lcdPoint_t *p = &points[segment];
+	const lcdPoint_t *q = (count > 1) ? &points[segment + 1] : p;
+	int32_t dx = q->x - p->x, dy = q->y - p->y;
+	float length = sqrtf((float)dx * dx + (float)dy * dy);
+
+	shape->segment = segment;
+	shape->bottom = (p->y > q->y) ? p->y : q->y;
+	shape->join = 0;
+	if (dx == 0 && dy == 0)
+		return;
+	shape->nx = (int32_t)(-dy * half * 256 / length);
+	shape->ny = (int32_t)(dx * half * 256 / length);
+
+	if (segment + 2 >= count)
+		return;
+	int32_t ex = points[segment + 2].x - q->x, ey = points[segment + 2].y - q->y;
+	int32_t turn = dx * ey - dy * ex;
+	if (ex == 0 && ey == 0)
+		return;
+	if (join == LCD_JOIN_ROUND) {
+		shape->join = 1;
+		return;
+	}
+	if (turn == 0)
+		return;
+
+	// Normals on the outer side of the corner
+	float side = (turn > 0) ? -1.0f : 1.0f;
+	float nextLength = sqrtf((float)ex * ex + (float)ey * ey);
+	float n1x = side * -dy / length, n1y = side * dx / length;
+	float n2x = side * -ey / nextLength, n2y = side * ex / nextLength;
+	float cosine = n1x * n2x + n1y * n2y;
+	shape->ax = (int32_t)(n1x * half * 256);
+	shape->ay = (int32_t)(n1y * half * 256);
+	shape->bx = (int32_t)(n2x * half * 256);
+	shape->by = (int32_t)(n2y * half * 256);
+	shape->join = 3;
+	if (join == LCD_JOIN_MITER && 1.0f + cosine >= 0.125f) {
+		float miter = half * 256 / (1.0f + cosine);
+		shape->mx = (int32_t)((n1x + n2x) * miter);
+		shape->my = (int32_t)((n1y + n2y) * miter);
+		shape->join = 4;
+	}
+}
+
+static void lcdConvexSpan(const int32_t *vx, const int32_t *vy, uint8_t count,
+		int32_t y, int32_t *x0, int32_t *x1) {
+	int64_t area = 0;
+	*x0 = INT16_MIN;
+	*x1 = INT16_MAX;
+
+	for (uint8_t i = 0; i < count; i++) {
+		uint8_t j = (i + 1) % count;
+		area += (int64_t)vx[i] * vy[j] - (int64_t)vx[j] * vy[i];
+	}
+	if (area == 0) {
+		*x0 = 1;
+		*x1 = 0;
+		return;
+	}
+
+	// Pixel center x inside each edge: a * x + b >= 0
+	for (uint8_t i = 0; i < count; i++) {
+		uint8_t j = (i + 1) % count;
+		int64_t ex = vx[j] - vx[i], ey = vy[j] - vy[i];
+		int64_t a = -ey * 256;
+		int64_t b = ex * (y - vy[i]) + ey * vx[i];
+		if (area < 0) {
+			a = -a;
+			b = -b;
+		}
+		if (a > 0) {
+			int32_t limit = -lcdFloorDiv(b, a);
+			if (limit > *x0)
+				*x0 = limit;
+		} else if (a < 0) {
+			int32_t limit = lcdFloorDiv(b, -a);
+			if (limit < *x1)
+				*x1 = limit;
+		} else if (b < 0) {
+			*x0 = 1;
+			*x1 = 0;
+			return;
+		}
+	}
+}
+
+static void lcdLinearRange(int64_t k, int64_t c, int64_t m, int32_t *x0, int32_t *x1) {
+	*x0 = INT16_MIN;
+	*x1 = INT16_MAX;
+	if (k > 0) {
+		*x0 = -lcdFloorDiv(c - m, k);
+	} else if (k < 0) {
+		*x1 = lcdFloorDiv(c - m, -k);
+	} else if (c < m) {
+		*x0 = 1;
+		*x1 = 0;
+	}
+	if (*x0 < INT16_MIN)
+		*x0 = INT16_MIN;
+	if (*x1 > INT16_MAX)
+		*x1 = INT16_MAX;
+}
+
+static uint32_t lcdSqrt(uint32_t value) {
+	uint32_t root = (uint32_t)sqrtf((float)value);
+	while (root * root > value)
+		root--;
+	while ((root + 1) * (root + 1) <= value)
+		root++;
+	return root;
+}
+
+static void lcdCapturePut(lcdCapture_t *capture, const uint8_t *data, uint16_t length) {
+	while (length-- && !capture->failed) {
+		capture->buffer[capture->length++] = *data++;
+		if (capture->length == LCD_CAPTURE_BUFFER)
+			lcdCaptureFlush(capture);
+	}
+}
+
+static void lcdCaptureFlush(lcdCapture_t *capture) {
+	if (capture->length && !capture->failed)
+		capture->failed = !capture->writer(capture->context, capture->buffer, capture->length);
+	capture->length = 0;
+}
+
+static void lcdCaptureRow(lcdCapture_t *capture, const uint16_t *pixels, uint16_t count) {
+	uint16_t i = 0;
+
+	while (i < count) {
+		uint16_t run = 1;
+		while (i + run < count && run < 128 && pixels[i + run] == pixels[i])
+			run++;
+
+		if (run > 1) {
+			const uint8_t packet[3] = { (uint8_t)(127 + run), (uint8_t)(pixels[i] & 0xFF), (uint8_t)(pixels[i] >> 8) };
+			lcdCapturePut(capture, packet, sizeof(packet));
+			i += run;
+			continue;
+		}
+
+		// Literal pixels up to the start of the next run
+		uint16_t literal = 1;
+		while (i + literal < count && literal < 128
+				&& !(i + literal + 1 < count && pixels[i + literal] == pixels[i + literal + 1]))
+			literal++;
+
+		const uint8_t length = literal - 1;
+		lcdCapturePut(capture, &length, 1);
+		for (uint16_t k = 0; k < literal; k++) {
+			const uint8_t pixel[2] = { (uint8_t)(pixels[i + k] & 0xFF), (uint8_t)(pixels[i + k] >> 8) };
+			lcdCapturePut(capture, pixel, sizeof(pixel));
+		}
+		i += literal;
+	}
+}
+
+static int32_t lcdSin(int16_t angle) {
+	angle %= 360;
+	if (angle < 0)
+		angle += 360;
+	if (angle <= 90)
+		return lcdSineTable[angle];
+	if (angle <= 180)
+		return lcdSineTable[180 - angle];
+	if (angle <= 270)
+		return -lcdSineTable[angle - 180];
+	return -lcdSineTable[360 - angle];
+}
+
+static inline uint32_t lcdBlendPair(uint32_t fg, uint32_t bg, uint32_t alpha) {
+	// Each channel of both pixels in its own 16 bit lane, so products do not overflow
+	uint32_t inverse = 32 - alpha;
+	uint32_t b = (((fg & 0x001F001F) * alpha + (bg & 0x001F001F) * inverse) >> 5) & 0x001F001F;
+	uint32_t g = ((((fg >> 5) & 0x003F003F) * alpha + ((bg >> 5) & 0x003F003F) * inverse) >> 5) & 0x003F003F;
+	uint32_t r = ((((fg >> 11) & 0x001F001F) * alpha + ((bg >> 11) & 0x001F001F) * inverse) >> 5) & 0x001F001F;
+	return (r << 11) | (g << 5) | b;
+}
+
+static void lcdRampStart(lcdColorRamp_t *ramp, uint16_t from, uint16_t to, int32_t steps, int32_t first) {
+	int32_t r = (from >> 11) & 0x1F, g = (from >> 5) & 0x3F, b = from & 0x1F;
+	int32_t span = (steps > 1) ? steps - 1 : 1;
+
+	ramp->dr = ((((to >> 11) & 0x1F) - r) * 65536) / span;
+	ramp->dg = ((((to >> 5) & 0x3F) - g) * 65536) / span;
+	ramp->db = (((to & 0x1F) - b) * 65536) / span;
+	ramp->r = r * 65536 + ramp->dr * first;
+	ramp->g = g * 65536 + ramp->dg * first;
+	ramp->b = b * 65536 + ramp->db * first;
+}
+
+static uint16_t lcdRampColor(const lcdColorRamp_t *ramp, int32_t step, uint16_t threshold) {
+	int32_t r = (ramp->r + ramp->dr * step + threshold) >> 16;
+	int32_t g = (ramp->g + ramp->dg * step + threshold) >> 16;
+	int32_t b = (ramp->b + ramp->db * step + threshold) >> 16;
+	return (r << 11) | (g << 5) | b;
+}
+
+static void lcdDiscSpan(int32_t cx, int32_t cy, int32_t radius, int32_t y, int32_t *x0, int32_t *x1) {
+	int32_t dy = y - cy;
+
+	if (dy < -radius || dy > radius) {
+		*x0 = 1;
+		*x1 = 0;
+		return;
+	}
+	int32_t half = (int32_t)sqrtf((float)radius * radius - (float)dy * dy);
+	*x0 = -lcdFloorDiv(half - cx, 256);
+	*x1 = lcdFloorDiv(cx + half, 256);
+}
+
+static const char *lcdNextTextLine(uint16_t charWidth, const char *text,
+		uint16_t boxWidth, lcdTextAlign_t align, lcdTextLine_t *line) {
+	uint16_t maxChars = boxWidth / charWidth;
+	uint16_t count = 0;
+	int16_t lastSpace = -1;
+	const char *next;
+
+	if (maxChars == 0)
+		maxChars = 1;
+
+	while (text[count] && text[count] != '\n' && count < maxChars) {
+		if (text[count] == ' ')
+			lastSpace = count;
+		count++;
+	}
+
+	if (text[count] == '\0') {
+		next = text + count;
+	} else if (text[count] == '\n') {
+		next = text + count + 1;
+	} else if (text[count] == ' ' || lastSpace > 0) {
+		// Word wrap, the spaces in the break are not drawn
+		if (text[count] != ' ')
+			count = lastSpace;
+		next = text + count;
+		while (*next == ' ')
+			next++;
+		if (*next == '\n')
+			next++;
+	} else {
+		// Word longer than the box, break it at the border
+		next = text + count;
+	}
+
+	while (count > 0 && (text[count - 1] == ' ' || text[count - 1] == '\r'))
+		count--;
+
+	line->text = text;
+	line->length = count;
+	line->width = count * charWidth;
+	line->y = 0;
+	switch (align) {
+	case LCD_ALIGN_CENTER:
+		line->x = (boxWidth - line->width) / 2;
+		break;
+	case LCD_ALIGN_RIGHT:
+		line->x = boxWidth - line->width;
+		break;
+	default:
+		line->x = 0;
+		break;
+	}
+	return next;
+}
+
 static void FSMC_init() {
 
 	static int FSMC_Initialized = 0;
@@ -964,22 +2861,22 @@ static void FSMC_init() {
 	SRAM_LCD.Init.WaitSignalActive = FSMC_WAIT_TIMING_BEFORE_WS;
 	SRAM_LCD.Init.WriteOperation = FSMC_WRITE_OPERATION_ENABLE;
 	SRAM_LCD.Init.WaitSignal = FSMC_WAIT_SIGNAL_DISABLE;
-	SRAM_LCD.Init.ExtendedMode = FSMC_EXTENDED_MODE_DISABLE;
+	SRAM_LCD.Init.ExtendedMode = FSMC_EXTENDED_MODE_ENABLE;
 	SRAM_LCD.Init.AsynchronousWait = FSMC_ASYNCHRONOUS_WAIT_DISABLE;
 	SRAM_LCD.Init.WriteBurst = FSMC_WRITE_BURST_DISABLE;
 	SRAM_LCD.Init.PageSize = FSMC_PAGE_SIZE_NONE;
-	/* Timing */
+	/* Timing, used for reads: the display needs 355ns of RD low to read memory */
 	Timing.AddressSetupTime = 2;
     Timing.AddressHoldTime = 15;
-    Timing.DataSetupTime = 4;
+    Timing.DataSetupTime = 60;
     Timing.BusTurnAroundDuration = 15;
     Timing.CLKDivision = 16;
     Timing.DataLatency = 17;
     Timing.AccessMode = FSMC_ACCESS_MODE_A;
-    /* ExtTiming */
-    ExtTiming.AddressSetupTime = 0;
+    /* ExtTiming, used for writes */
+    ExtTiming.AddressSetupTime = 2;
     ExtTiming.AddressHoldTime = 15;
-    ExtTiming.DataSetupTime = 3;
+    ExtTiming.DataSetupTime = 4;
     ExtTiming.BusTurnAroundDuration = 15;
     ExtTiming.CLKDivision = 16;
     ExtTiming.DataLatency = 17;
@@ -59,9 +59,34 @@ typedef enum {
 #endif
 #define swap(a, b) { int16_t t = a; a = b; b = t; }
 
+/**
+ * @brief  Define LCD_THREAD_SAFE to share one display between threads.
+ *         Each drawing function holds the display mutex while it runs,
+ *         so its window setup and pixel stream are never interleaved.
+ *         Without it the lock is compiled out.
+ */
+#ifdef LCD_THREAD_SAFE
+#define LCD_LOCK(display)	mbed::ScopedLock<rtos::Mutex> lcdLock((display).BusMutex)
+#else
+#define LCD_LOCK(display)
+#endif
+
 #define ILI9341_PIXEL_WIDTH		240
 #define ILI9341_PIXEL_HEIGHT 	320
 
+#define LCD_CLIP_STACK_SIZE		8
+#define LCD_POLYGON_MAX_EDGES	64
+
+#define LCD_NO_KEY				0x10000     // Key color that no pixel has
+
+#ifndef LCD_CAPTURE_BUFFER
+#define LCD_CAPTURE_BUFFER		64
+#endif
+
+#ifndef LCD_POLYLINE_MAX_POINTS
+#define LCD_POLYLINE_MAX_POINTS	256
+#endif
+
 /**
  * @brief  Orientation for dispay
  */
@@ -80,6 +105,7 @@ typedef struct {
 	uint32_t BackColor;
 	font_t *pFont;
 	uint8_t TextWrap;
+	uint8_t TextScale;
 } lcdFontProperties_t;
 
 /**
@@ -90,6 +116,191 @@ typedef struct {
 	uint16_t y;
 } lcdCursorPos_t;
 
+/**
+ * @brief  Text state of one writer, to print from many threads
+ *         without sharing font, colors and cursor
+ */
+typedef struct {
+	lcdFontProperties_t font;
+	lcdCursorPos_t cursor;
+} lcdTextState_t;
+
+/**
+ * @brief  Clip rectangle and origin of drawings
+ *         All coordinates are in screen pixels, the rectangle is inclusive
+ */
+typedef struct {
+	int16_t x0;
+	int16_t y0;
+	int16_t x1;
+	int16_t y1;
+	int16_t originX;    // Screen position of local x = 0
+	int16_t originY;    // Screen position of local y = 0
+} lcdClip_t;
+
+/**
+ * @brief  Point of a polygon
+ */
+typedef struct {
+	int16_t x;
+	int16_t y;
+} lcdPoint_t;
+
+/**
+ * @brief  Pixel of a batch, with its own color
+ */
+typedef struct {
+	int16_t x;
+	int16_t y;
+	uint16_t color;
+} lcdPixel_t;
+
+/**
+ * @brief  Rule to decide what is inside of a polygon
+ */
+typedef enum {
+	LCD_FILL_EVEN_ODD = 0,
+	LCD_FILL_NONZERO = 1
+} lcdFillRule_t;
+
+/**
+ * @brief  Edge of a polygon in the scanline filler
+ */
+typedef struct {
+	int32_t x;          // x at center of current scanline, 16.16 fixed point
+	int32_t dxdy;       // x step per scanline, 16.16 fixed point
+	int16_t yTop;       // First scanline of the edge
+	int16_t yBottom;    // Scanline after the last one
+	int8_t winding;     // 1 going down, -1 going up
+} lcdEdge_t;
+
+/**
+ * @brief  Horizontal span of a scanline, inclusive
+ */
+typedef struct {
+	int16_t x0;
+	int16_t x1;
+} lcdSpan_t;
+
+/**
+ * @brief  Direction of a gradient in a rectangle
+ */
+typedef enum {
+	LCD_GRADIENT_HORIZONTAL = 0,    // Color changes from left to right
+	LCD_GRADIENT_VERTICAL = 1       // Color changes from top to bottom
+} lcdGradient_t;
+
+/**
+ * @brief  How pixels of a transformed image are taken from the source
+ */
+typedef enum {
+	LCD_SAMPLE_NEAREST = 0,     // Closest source pixel
+	LCD_SAMPLE_BILINEAR = 1     // Weighted by the four closest source pixels
+} lcdSampling_t;
+
+/**
+ * @brief  Quarter turns of an image or text, clockwise
+ */
+typedef enum {
+	LCD_ROTATE_0 = 0,
+	LCD_ROTATE_90 = 1,
+	LCD_ROTATE_180 = 2,
+	LCD_ROTATE_270 = 3
+} lcdRotation_t;
+
+/**
+ * @brief  Shape of the corners between segments of a thick polyline
+ */
+typedef enum {
+	LCD_JOIN_MITER = 0,     // Sharp corner, bevel if longer than 4 times the width
+	LCD_JOIN_ROUND = 1,
+	LCD_JOIN_BEVEL = 2
+} lcdLineJoin_t;
+
+/**
+ * @brief  Shape of the ends of a thick line
+ */
+typedef enum {
+	LCD_CAP_BUTT = 0,       // Ends at the end point
+	LCD_CAP_ROUND = 1       // Half circle beyond the end point
+} lcdLineCap_t;
+
+/**
+ * @brief  Horizontal alignment of text inside a box
+ */
+typedef enum {
+	LCD_ALIGN_LEFT = 0,
+	LCD_ALIGN_CENTER = 1,
+	LCD_ALIGN_RIGHT = 2
+} lcdTextAlign_t;
+
+/**
+ * @brief  Size of a text block in pixels
+ */
+typedef struct {
+	uint16_t width;
+	uint16_t height;
+} lcdTextSize_t;
+
+/**
+ * @brief  One line produced by the text layout
+ *         x and y are relative to the top left corner of the box
+ */
+typedef struct {
+	const char *text;   // First character of the line
+	uint16_t length;    // Number of characters to draw
+	int16_t x;          // Offset of the first glyph inside the box
+	int16_t y;          // Offset of the line inside the box
+	uint16_t width;     // Width of the glyphs, without padding
+} lcdTextLine_t;
+
+
+/**
+ * @brief  Pointer to the bitmap of one row of a glyph
+ *         Characters out of font are drawn as space
+ *
+ * @param font	Font of the glyph
+ * @param c		Character
+ * @param row	Row of the glyph, from 0 to font height - 1
+ *
+ * @return const uint8_t*	First byte of the row, MSB is the left pixel
+ */
+const uint8_t *lcdGlyphRow(const font_t *font, uint8_t c, uint16_t row);
+
+/**
+ * @brief  Find the runs of pixels of an image that are not the transparent color,
+ *         in the format of sImageRuns_t
+ *
+ * @param image	16 bits image
+ * @param key	Transparent color
+ * @param runs	Receives the runs, height * (width + 1) words are always enough
+ * @param size	Size of runs in words
+ *
+ * @return uint32_t	Words used, 0 if runs is too small
+ */
+uint32_t lcdImageRuns(const sImage_t *image, uint16_t key, uint16_t *runs, uint32_t size);
+
+/**
+ * @brief  Receives the bytes of a screen capture, returns false to stop the capture
+ */
+typedef bool (*lcdCaptureWriter_t)(void *context, const uint8_t *data, uint16_t length);
+
+/**
+ * @brief  State of a screen capture, sent in bands of rows.
+ *         Stream: "LCDS", width and height (16 bits little endian), then
+ *         packets of pixels, row by row. A packet starts with a byte n:
+ *         n < 128 is followed by n + 1 pixels, n >= 128 by one pixel
+ *         repeated n - 127 times. Pixels are RGB565, little endian.
+ */
+typedef struct {
+	lcdCaptureWriter_t writer;
+	void *context;
+	uint16_t bandRows;      // Rows read for each band
+	uint16_t row;           // Next row to read
+	bool failed;            // The writer stopped the capture
+	uint16_t length;        // Bytes waiting in buffer
+	uint8_t buffer[LCD_CAPTURE_BUFFER];
+} lcdCapture_t;
 
 /**
  * @brief  Properties structures to define resources to different displays
@@ -116,6 +327,12 @@ typedef struct {
  * @return void
 */
 class ILI9341 {
+	friend class ILI9341Console;
+	friend class ILI9341Sprites;
+	friend class ILI9341Trace;
+	friend class ILI9341StripChart;
+	template<class, uint16_t, uint16_t, bool, bool> friend struct lcdGlyphWriter;
+
 protected:
 
 	volatile uint16_t* fsmcCMD;
@@ -132,20 +349,58 @@ protected:
 	};
 
 	lcdFontProperties_t Font = {
-			GREEN, BLACK, &Font12, 1
+			GREEN, BLACK, &Font12, 1, 1
 	};
 
 	lcdCursorPos_t cursorXY = { 0, 0 };
 
+	lcdClip_t Clip;
+	lcdClip_t ClipStack[LCD_CLIP_STACK_SIZE];
+	uint8_t ClipDepth = 0;
+	bool ReadStarted = false;
+
 	uint8_t PortraitConfig = 0;
 	uint8_t LandscapeConfig = 0;
 	uint8_t PortraitMirrorConfig = 0;
 	uint8_t LandscapeMirrorConfig = 0;
+	uint8_t MemoryConfig = 0;          // MEMCONTROL value of the current orientation
+	lcdClip_t RotationClip;            // Clip saved while drawing rotated
+
+#ifdef LCD_THREAD_SAFE
+	rtos::Mutex BusMutex;              // Recursive, public functions can call each other
+#endif
 
 	inline void writeCommand(uint8_t command) {*fsmcCMD = command;}
     inline void writeData(uint16_t data) {*fsmcDATA = data;}
+    void setColumns(uint16_t x0, uint16_t x1);
+    void setPages(uint16_t y0, uint16_t y1);
+    void setAddress(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
     void setWindow(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
     inline uint16_t readData(void) {return *fsmcDATA;}
+    inline void writeColor(uint16_t color, uint32_t count) {while (count--) writeData(color);}
+    inline uint16_t charWidth(void) {return Font.pFont->Width * Font.TextScale;}
+    inline uint16_t charHeight(void) {return Font.pFont->Height * Font.TextScale;}
+    bool clipWindow(int16_t &x0, int16_t &y0, int16_t &x1, int16_t &y1);
+    void fillWindow(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color);
+    void writeClippedPixels(int16_t x, int16_t y, const uint16_t *data, uint16_t length);
+    void writeClippedRect(int16_t x, int16_t y, int16_t width, int16_t height, const uint16_t *data, uint16_t stride);
+    void readClippedRect(int16_t x, int16_t y, int16_t width, int16_t height, uint16_t *buffer, uint16_t stride);
+    void drawGlyph(const font_t *font, uint8_t scale, int16_t x, int16_t y, uint8_t c, uint16_t color, uint16_t bg);
+    void writeClippedRun(int16_t &px, int16_t length, uint16_t color, int16_t x0, int16_t x1);
+    void writeGlyphRow(const font_t *font, uint8_t scale, const uint8_t *bits, int16_t &px, int16_t x0, int16_t x1, uint16_t color, uint16_t bg);
+    void readPixels(uint16_t *buffer, uint32_t count, uint16_t columns, uint16_t stride, uint8_t command);
+    void blendWindow(int16_t x, int16_t y, int16_t x1, int16_t y1, const sImage_t *image, uint16_t color, uint8_t alpha);
+    void fillSpans(lcdSpan_t *spans, uint16_t count, int16_t y, uint16_t color);
+    void drawEllipseRows(int16_t x0, int16_t y0, uint16_t radiusX, uint16_t radiusY, uint16_t color, bool fill);
+    void fillSector(int16_t x0, int16_t y0, uint16_t innerRadius, uint16_t outerRadius,
+    		int16_t start, int16_t end, uint16_t color);
+    void drawTextLine(int16_t x, int16_t y, uint16_t boxWidth, const lcdTextLine_t *line, uint16_t color, uint16_t bg);
+    void writePixel(int16_t x, int16_t y, uint16_t color);
+    void printText(const char *text);
+    void swapTextState(lcdTextState_t *state);
+    void beginRotation(int16_t x, int16_t y, int16_t width, int16_t height, lcdRotation_t rotation,
+    		int16_t &sourceX, int16_t &sourceY);
+    void endRotation(void);
 	
     virtual int _putc(int value);
     virtual int _getc();
@@ -194,6 +449,7 @@ public:
 
 	/**
 	* @brief Fill the screen with a selected color
+	*        If a clip is set only the clip area is filled
 	*
 	* @param color	Color to fill screen
 	*
@@ -210,8 +466,21 @@ public:
 	*
 	* @return void
 	*/
-	void drawPixel(uint16_t x, uint16_t y, uint16_t color);
-    void drawPixels(uint16_t x, uint16_t y, uint16_t *data,	uint32_t dataLength);
+	void drawPixel(int16_t x, int16_t y, uint16_t color);
+    void drawPixels(int16_t x, int16_t y, uint16_t *data,	uint32_t dataLength);
+
+	/**
+	* @brief Draw many pixels in any order, each with its color.
+	*        Pixels are sorted by row, neighbours in a row are written as one run
+	*        and the column or page address is sent only when it changes.
+	*        When two pixels have the same position any of them is drawn
+	*
+	* @param points	Pixels to draw, the array is sorted in place
+	* @param count	Number of pixels
+	*
+	* @return void
+	*/
+	void drawPixelBatch(lcdPixel_t *points, uint16_t count);
 
 	/**
 	* @brief Draw a line
@@ -236,7 +505,7 @@ public:
 	*
 	* @return void
 	*/
-	void drawFastHLine(uint16_t x, uint16_t y, uint16_t width, uint16_t color);
+	void drawFastHLine(int16_t x, int16_t y, int16_t width, uint16_t color);
 
 	/**
 	* @brief Draw a vertical line
@@ -248,7 +517,7 @@ public:
 	*
 	* @return void
 	*/
-	void drawFastVLine(uint16_t x, uint16_t y, uint16_t height, uint16_t color);
+	void drawFastVLine(int16_t x, int16_t y, int16_t height, uint16_t color);
 
 	/**
 	* @brief Draw a rectangle
@@ -278,6 +547,38 @@ public:
 	*/
 	void fillRect(int16_t x, int16_t y, int16_t width, int16_t height, uint16_t fillcolor);
 
+	/**
+	* @brief Draw a rectangle filled with a linear gradient, in one window
+	*
+	* @param x			x-coordinate axis
+	* @param y			y-coordinate axis
+	* @param width		Width of rectangle
+	* @param height		Height of rectangle
+	* @param from		Color at left or top
+	* @param to			Color at right or bottom
+	* @param direction	Horizontal or vertical
+	* @param dither		Ordered dithering between the 565 levels
+	*
+	* @return void
+	*/
+	void fillRectGradient(int16_t x, int16_t y, int16_t width, int16_t height, uint16_t from, uint16_t to,
+			lcdGradient_t direction, bool dither = false);
+
+	/**
+	* @brief Draw a translucent rectangle over the screen.
+	*        Each row is read back, blended and written in the same window.
+	*
+	* @param x		x-coordinate axis
+	* @param y		y-coordinate axis
+	* @param width	Width of rectangle
+	* @param height	Height of rectangle
+	* @param color	Color of rectangle
+	* @param alpha	Opacity, 0 to 255
+	*
+	* @return void
+	*/
+	void fillRectAlpha(int16_t x, int16_t y, int16_t width, int16_t height, uint16_t color, uint8_t alpha);
+
 	/**
 	* @brief Draw a rectangle with no sharps
 	* 		 Safe for kids
@@ -353,6 +654,111 @@ public:
 	*/
 	void fillCircleHelper(int16_t x0, int16_t y0, int16_t radius, uint8_t cornername, int16_t delta, uint16_t color);
 
+	/**
+	 * @brief Draw an arc of a circle outline.
+	 *        Angles are in degrees, 0 at 3 o'clock and growing clockwise.
+	 *        The arc covers start up to, but not including, end.
+	 *
+	 * @param x0		x-coordinate of center
+	 * @param y0		y-coordinate of center
+	 * @param radius	Radius
+	 * @param start		Start angle
+	 * @param end		End angle, 360 or more past start for a full circle
+	 * @param color		Color
+	 *
+	 * @return void
+	 */
+	void drawArc(int16_t x0, int16_t y0, uint16_t radius, int16_t start, int16_t end, uint16_t color);
+
+	/**
+	 * @brief Fill a segment of a ring, angles as in drawArc
+	 *
+	 * @param x0			x-coordinate of center
+	 * @param y0			y-coordinate of center
+	 * @param innerRadius	Radius of the hole
+	 * @param outerRadius	Radius of the ring
+	 * @param start			Start angle
+	 * @param end			End angle
+	 * @param color			Color
+	 *
+	 * @return void
+	 */
+	void fillArc(int16_t x0, int16_t y0, uint16_t innerRadius, uint16_t outerRadius,
+			int16_t start, int16_t end, uint16_t color);
+
+	/**
+	 * @brief Fill a slice of a circle, angles as in drawArc
+	 *
+	 * @param x0		x-coordinate of center
+	 * @param y0		y-coordinate of center
+	 * @param radius	Radius
+	 * @param start		Start angle
+	 * @param end		End angle
+	 * @param color		Color
+	 *
+	 * @return void
+	 */
+	void fillPie(int16_t x0, int16_t y0, uint16_t radius, int16_t start, int16_t end, uint16_t color);
+
+	/**
+	 * @brief Move the end of a ring gauge, only the angles between the
+	 *        old and the new end are drawn
+	 *
+	 * @param x0			x-coordinate of center
+	 * @param y0			y-coordinate of center
+	 * @param innerRadius	Radius of the hole
+	 * @param outerRadius	Radius of the ring
+	 * @param oldEnd		End angle drawn before
+	 * @param newEnd		End angle to show
+	 * @param color			Color of the gauge
+	 * @param bg			Color of the empty part of the ring
+	 *
+	 * @return void
+	 */
+	void updateArc(int16_t x0, int16_t y0, uint16_t innerRadius, uint16_t outerRadius,
+			int16_t oldEnd, int16_t newEnd, uint16_t color, uint16_t bg);
+
+	/**
+	 * @brief Draw an ellipse outline
+	 *
+	 * @param x0		x-coordinate of center
+	 * @param y0		y-coordinate of center
+	 * @param radiusX	Horizontal radius
+	 * @param radiusY	Vertical radius
+	 * @param color		Color
+	 *
+	 * @return void
+	 */
+	void drawEllipse(int16_t x0, int16_t y0, uint16_t radiusX, uint16_t radiusY, uint16_t color);
+
+	/**
+	 * @brief Draw a filled ellipse
+	 *
+	 * @param x0		x-coordinate of center
+	 * @param y0		y-coordinate of center
+	 * @param radiusX	Horizontal radius
+	 * @param radiusY	Vertical radius
+	 * @param color		Color
+	 *
+	 * @return void
+	 */
+	void fillEllipse(int16_t x0, int16_t y0, uint16_t radiusX, uint16_t radiusY, uint16_t color);
+
+	/**
+	 * @brief Draw a circle filled with a radial gradient
+	 *
+	 * @param x0		x-coordinate of center
+	 * @param y0		y-coordinate of center
+	 * @param radius	Radius
+	 * @param inner		Color at the center
+	 * @param outer		Color at the border
+	 * @param dither	Ordered dithering between the 565 levels
+	 *
+	 * @return void
+	 */
+	void fillCircleGradient(int16_t x0, int16_t y0, uint16_t radius, uint16_t inner, uint16_t outer,
+			bool dither = false);
+
 	/**
 	 * @brief Draw a triangle
 	 * @param x0  	Vertex #0 x coordinate
@@ -381,6 +787,59 @@ public:
 	*/
 	void fillTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color);
 
+	/**
+	 * @brief Draw a filled polygon, convex or concave, with any number of points.
+	 *        Pixels with center inside the polygon are filled, each scanline
+	 *        in spans, so polygons sharing an edge don't overlap.
+	 *        The edges live in the array given or in a static array of
+	 *        LCD_POLYGON_MAX_EDGES, the heap is never used.
+	 *
+	 * @param points	Vertices of the polygon, the last one connects to the first
+	 * @param count		Number of vertices
+	 * @param color		Color
+	 * @param rule		LCD_FILL_EVEN_ODD or LCD_FILL_NONZERO
+	 * @param edges		Array for the edges, NULL uses the static array
+	 * @param maxEdges	Size of array edges, at least count
+	 *
+	 * @return bool		False if there is no room for the edges
+	*/
+	bool fillPolygon(const lcdPoint_t *points, uint16_t count, uint16_t color,
+			lcdFillRule_t rule = LCD_FILL_EVEN_ODD,
+			lcdEdge_t *edges = NULL, uint16_t maxEdges = 0);
+
+	/**
+	 * @brief Draw a line with width, rasterized in horizontal spans
+	 *
+	 * @param x0	x-coordinate start
+	 * @param y0	y-coordinate start
+	 * @param x1	x-coordinate end
+	 * @param y1	y-coordinate end
+	 * @param width	Width of line in pixels
+	 * @param color	Color of line
+	 * @param cap	Shape of the ends
+	 *
+	 * @return void
+	*/
+	void drawThickLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t width,
+			uint16_t color, lcdLineCap_t cap = LCD_CAP_BUTT);
+
+	/**
+	 * @brief Draw connected segments with width.
+	 *        The segments, joins and caps of a scanline are merged before
+	 *        drawing, so each pixel is written once.
+	 *
+	 * @param points	Points of the line
+	 * @param count		Number of points, up to LCD_POLYLINE_MAX_POINTS
+	 * @param width		Width of line in pixels
+	 * @param color		Color of line
+	 * @param join		Shape of the corners
+	 * @param cap		Shape of the ends
+	 *
+	 * @return bool		False if there are too many points
+	*/
+	bool drawPolyline(const lcdPoint_t *points, uint16_t count, uint16_t width, uint16_t color,
+			lcdLineJoin_t join = LCD_JOIN_MITER, lcdLineCap_t cap = LCD_CAP_BUTT);
+
 	/**
 	 * @brief Draw bitmap image
 	 * @param x  	 	Vertex #0 x coordinate
@@ -389,7 +848,70 @@ public:
 	 *
 	 * @return void
 	*/
-	void drawImage(uint16_t x, uint16_t y, const sImage_t *pBitmap);
+	void drawImage(int16_t x, int16_t y, const sImage_t *pBitmap);
+
+	/**
+	 * @brief Draw bitmap image, pixels with the key color are not drawn.
+	 *        Each run of other pixels is written as a span.
+	 * @param x  	 	x-coordinate
+	 * @param y  	 	y-coordinate
+	 * @param pBitmap   A pointer to sImage_t type of image
+	 * @param key		Transparent color
+	 *
+	 * @return void
+	*/
+	void drawImage(int16_t x, int16_t y, const sImage_t *pBitmap, uint16_t key);
+
+	/**
+	 * @brief Draw bitmap image with transparency from runs found before,
+	 *        no pixel is compared while drawing
+	 * @param x  	 	x-coordinate
+	 * @param y  	 	y-coordinate
+	 * @param pRuns     Image and its opaque runs
+	 *
+	 * @return void
+	*/
+	void drawImage(int16_t x, int16_t y, const sImageRuns_t *pRuns);
+
+	/**
+	 * @brief Draw bitmap image turned by quarter turns. The scan order of the
+	 *        controller is changed while drawing, so the image is streamed
+	 *        unchanged as fast as drawImage without rotation
+	 * @param x  	 	x-coordinate of the top left corner of the turned image
+	 * @param y  	 	y-coordinate of the top left corner of the turned image
+	 * @param pBitmap   A pointer to sImage_t type of image
+	 * @param rotation	Quarter turns, clockwise
+	 *
+	 * @return void
+	*/
+	void drawImage(int16_t x, int16_t y, const sImage_t *pBitmap, lcdRotation_t rotation);
+
+	/**
+	 * @brief Draw bitmap image rotated and scaled around its center.
+	 *        Only pixels covered by the image are written, in spans.
+	 * @param pBitmap   A pointer to sImage_t type of image
+	 * @param cx  	 	x-coordinate of the image center, left edge of this column for even widths
+	 * @param cy  	 	y-coordinate of the image center, top edge of this row for even heights
+	 * @param angle		Rotation in degrees, clockwise
+	 * @param scale		Scale in 8.8 fixed point, 256 is the original size
+	 * @param sampling	Nearest or bilinear
+	 * @param key		Transparent color, or LCD_NO_KEY
+	 *
+	 * @return void
+	*/
+	void drawImageTransformed(const sImage_t *pBitmap, int16_t cx, int16_t cy, int16_t angle,
+			uint16_t scale = 256, lcdSampling_t sampling = LCD_SAMPLE_NEAREST, uint32_t key = LCD_NO_KEY);
+
+	/**
+	 * @brief Draw a bitmap image blended over the screen
+	 * @param x  	 	x-coordinate
+	 * @param y  	 	y-coordinate
+	 * @param pBitmap   A pointer to sImage_t type of image
+	 * @param alpha		Opacity of image, 0 to 255
+	 *
+	 * @return void
+	*/
+	void blitAlpha(int16_t x, int16_t y, const sImage_t *pBitmap, uint8_t alpha);
 
 	/**
 	 * @brief Draw a character at the specified coordinates
@@ -404,7 +926,50 @@ public:
 	 * @return void
 	 */
 	void drawChar(int16_t x, int16_t y, uint8_t c, uint16_t color, uint16_t bg);
+
+	/**
+	 * @brief Draw a character with a built-in font known at compile time,
+	 *        rows and columns of the glyph are unrolled with constant strides.
+	 *        The text scale is not applied, glyphs partially out of screen
+	 *        or with transparent background use the runtime renderer.
+	 *
+	 * @code
+	 * display.drawChar<Font24_t>(x, y, '8', WHITE, BLACK);
+	 * @endcode
+	 *
+	 * @param x		    x-coordinate
+	 * @param y		    y-coordinate
+	 * @param c		    Character
+	 * @param color	    Character color
+	 * @param bg		Background color
+	 *
+	 * @return void
+	 */
+	template<class FONT>
+	void drawChar(int16_t x, int16_t y, uint8_t c, uint16_t color, uint16_t bg);
+
+	/**
+	 * @brief Draw a string with a built-in font known at compile time,
+	 *        no wrap, control characters are drawn as spaces
+	 *
+	 * @return void
+	 */
+	template<class FONT>
+	void drawString(int16_t x, int16_t y, const char *text, uint16_t color, uint16_t bg);
+
     void printf(const char *fmt, ...);
+
+	/**
+	 * @brief Print with the font, colors and cursor of a text state,
+	 *        the cursor of the state is moved. The text state of the
+	 *        display is not changed
+	 *
+	 * @param state		Text state of the writer
+	 * @param fmt		Format, as printf
+	 *
+	 * @return void
+	 */
+	void printf(lcdTextState_t *state, const char *fmt, ...);
     void clrLine(uint16_t bg);
     void clrLine();
 
@@ -436,6 +1001,92 @@ public:
 	 */
 	void setTextWrap(uint8_t wrap);
 
+	/**
+	 * @brief Set the text scale, each pixel of the font became a
+	 *        scale x scale block. Font24 with scale 4 gives 68x96 digits
+	 *
+	 * @param scale	Integer scale factor, 1 is the font size
+	 *
+	 * @return void
+	 */
+	void setTextScale(uint8_t scale);
+
+	/**
+	 * @brief Measure a text with the current font, without drawing it
+	 *        Lines are broken only at '\n'
+	 *
+	 * @param text	Null terminated string
+	 *
+	 * @return lcdTextSize_t	Width of the longest line and height of all lines
+	 */
+	lcdTextSize_t measureText(const char *text);
+
+	/**
+	 * @brief Break a text in lines that fit in a box, with word wrap and alignment
+	 *        Words longer than the box are broken at the box border
+	 *
+	 * @param text		Null terminated string
+	 * @param boxWidth	Width of the box in pixels
+	 * @param align		Alignment of each line inside the box
+	 * @param lines		Array to receive the lines, can be NULL to only count them
+	 * @param maxLines	Size of the array lines, only the first maxLines are stored
+	 * @param bounds	If not NULL, receive the size of the text block
+	 *
+	 * @return uint16_t	Number of lines in the layout, also those not stored
+	 */
+	uint16_t layoutText(const char *text, uint16_t boxWidth, lcdTextAlign_t align,
+			lcdTextLine_t *lines, uint16_t maxLines, lcdTextSize_t *bounds = NULL);
+
+	/**
+	 * @brief Draw a text inside a box, with word wrap and alignment
+	 *        Each line fills its background and glyphs in one window,
+	 *        so the box don't need to be cleared before
+	 *
+	 * @param x			x-coordinate of the box
+	 * @param y			y-coordinate of the box
+	 * @param boxWidth	Width of the box, 0 uses the width of the text
+	 * @param text		Null terminated string
+	 * @param align		Alignment of each line inside the box
+	 * @param rotation	Quarter turns of the box, clockwise. x and y are the
+	 *					top left corner of the turned box on screen
+	 *
+	 * @return lcdTextSize_t	Size of the area painted, before the turn
+	 */
+	lcdTextSize_t drawText(int16_t x, int16_t y, uint16_t boxWidth, const char *text,
+			lcdTextAlign_t align = LCD_ALIGN_LEFT, lcdRotation_t rotation = LCD_ROTATE_0);
+
+	/**
+	 * @brief Same as drawText, with the font and colors of a text state
+	 *
+	 * @return lcdTextSize_t	Size of the area painted, before the turn
+	 */
+	lcdTextSize_t drawText(const lcdTextState_t *state, int16_t x, int16_t y, uint16_t boxWidth,
+			const char *text, lcdTextAlign_t align = LCD_ALIGN_LEFT, lcdRotation_t rotation = LCD_ROTATE_0);
+
+	/**
+	 * @brief Get the current font, colors and cursor, to start a text state
+	 *
+	 * @return lcdTextState_t
+	 */
+	lcdTextState_t getTextState(void);
+
+	/**
+	 * @brief Take the display for a sequence of calls that must not be
+	 *        interleaved with other threads, as a clip change and the
+	 *        drawings inside it or readWindow and readContinue.
+	 *        Does nothing without LCD_THREAD_SAFE
+	 *
+	 * @return void
+	 */
+	void lock(void);
+
+	/**
+	 * @brief Release the display taken by lock
+	 *
+	 * @return void
+	 */
+	void unlock(void);
+
 	/**
 	 * @brief Set the orientation of display
 	 *
@@ -445,6 +1096,70 @@ public:
 	*/
 	void setOrientation(lcdOrientation_t orientation);
 
+	/**
+	 * @brief Set the lines of the panel that scroll. Lines are counted along
+	 *        the 320 pixels axis of the panel, from its top in portrait
+	 *        orientation, the lines out of the area stay fixed
+	 *
+	 * @param topFixed		Fixed lines before the scroll area
+	 * @param bottomFixed	Fixed lines after the scroll area
+	 *
+	 * @return void
+	*/
+	void setScrollArea(uint16_t topFixed, uint16_t bottomFixed);
+
+	/**
+	 * @brief Set the memory line shown at the first line of the scroll area
+	 *
+	 * @param line	Line from topFixed to the last line of the scroll area
+	 *
+	 * @return void
+	*/
+	void setScrollStart(uint16_t line);
+
+	/**
+	 * @brief Restrict the drawings to a rectangle inside the current clip
+	 *        Coordinates are local to the current origin
+	 *
+	 * @param x			x-coordinate of the rectangle
+	 * @param y			y-coordinate of the rectangle
+	 * @param width		Width of the rectangle
+	 * @param height	Height of the rectangle
+	 *
+	 * @return bool		False if the stack is full, nothing changes
+	 */
+	bool pushClip(int16_t x, int16_t y, int16_t width, int16_t height);
+
+	/**
+	 * @brief Same as pushClip, and the top left corner of the rectangle
+	 *        became the origin, so a panel is drawn in its own coordinates
+	 *
+	 * @return bool		False if the stack is full, nothing changes
+	 */
+	bool pushViewport(int16_t x, int16_t y, int16_t width, int16_t height);
+
+	/**
+	 * @brief Restore the clip and origin before last push
+	 *
+	 * @return void
+	 */
+	void popClip(void);
+
+	/**
+	 * @brief Clear the stack, drawings go to all screen again
+	 *        Changing the orientation also resets the clip
+	 *
+	 * @return void
+	 */
+	void resetClip(void);
+
+	/**
+	 * @brief Get the current clip rectangle and origin
+	 *
+	 * @return lcdClip_t
+	 */
+	lcdClip_t getClip(void);
+
 	/**
 	 * @brief Set cursor to initial position (x = 0, y = 0)
 	 *
@@ -546,7 +1261,78 @@ public:
      *
 	 * @return uint16_t
 	*/
-	uint16_t readPixel(uint16_t x, uint16_t y);
+	uint16_t readPixel(int16_t x, int16_t y);
+
+    /**
+	 * @brief Read the pixels of a rectangle in one window.
+	 *        Pixels outside the clip rectangle are left unchanged in buffer
+     *
+     * @param x         x-coordinate
+     * @param y         y-coordinate
+     * @param width     Width of rectangle
+     * @param height    Height of rectangle
+     * @param buffer    Receives width * height colors, row by row
+     *
+	 * @return void
+	*/
+	void readRect(int16_t x, int16_t y, int16_t width, int16_t height, uint16_t *buffer);
+
+    /**
+	 * @brief Open a window to be read in parts with readContinue
+     *
+     * @param x         x-coordinate
+     * @param y         y-coordinate
+     * @param width     Width of rectangle
+     * @param height    Height of rectangle
+     *
+	 * @return bool     False if the rectangle is not all inside the clip rectangle
+	*/
+	bool readWindow(int16_t x, int16_t y, int16_t width, int16_t height);
+
+    /**
+	 * @brief Read the next pixels of the window opened by readWindow.
+	 *        All parts but the last must have an even number of pixels,
+	 *        two pixels share the bytes of one read.
+     *
+     * @param buffer    Receives the colors
+     * @param count     Number of pixels
+     *
+	 * @return void
+	*/
+	void readContinue(uint16_t *buffer, uint32_t count);
+
+    /**
+	 * @brief Start a compressed capture of the screen, nothing is read yet.
+	 *        The clip rectangle does not apply.
+     *
+     * @param capture   State of the capture
+     * @param writer    Function to send the bytes
+     * @param context   Passed to writer
+     * @param bandRows  Rows read for each call of captureBand
+     *
+	 * @return void
+	*/
+	void beginCapture(lcdCapture_t *capture, lcdCaptureWriter_t writer, void *context, uint16_t bandRows = 8);
+
+    /**
+	 * @brief Read, compress and send the next band of a capture.
+	 *        Calls can be spread in time, the bus is free between bands.
+     *
+     * @param capture   State of the capture
+     *
+	 * @return bool     True while there are more bands to send
+	*/
+	bool captureBand(lcdCapture_t *capture);
+
+    /**
+	 * @brief Send a compressed capture of the whole screen
+     *
+     * @param writer    Function to send the bytes
+     * @param context   Passed to writer
+     *
+	 * @return bool     False if the writer stopped the capture
+	*/
+	bool captureScreen(lcdCaptureWriter_t writer, void *context);
 
     /**
 	 * @brief Reset the display
@@ -557,4 +1343,55 @@ public:
 
 };
 
+/**
+ * @brief  Unrolled writer of a glyph for a compile time font.
+ *         Each instance writes one pixel and calls the next column,
+ *         at the end of a row goes to next row until the last one
+ */
+template<class FONT, uint16_t ROW = 0, uint16_t COL = 0,
+		bool ROW_END = (ROW >= FONT::Height), bool COL_END = (COL >= FONT::Width)>
+struct lcdGlyphWriter {
+	static MBED_FORCEINLINE void write(ILI9341 &lcd, const uint8_t *glyph, uint16_t color, uint16_t bg) {
+		lcd.writeData((glyph[ROW * FONT::BytesPerRow + (COL >> 3)] & (0x80 >> (COL & 7))) ? color : bg);
+		lcdGlyphWriter<FONT, ROW, COL + 1>::write(lcd, glyph, color, bg);
+	}
+};
+
+template<class FONT, uint16_t ROW, uint16_t COL>
+struct lcdGlyphWriter<FONT, ROW, COL, false, true> {
+	static MBED_FORCEINLINE void write(ILI9341 &lcd, const uint8_t *glyph, uint16_t color, uint16_t bg) {
+		lcdGlyphWriter<FONT, ROW + 1, 0>::write(lcd, glyph, color, bg);
+	}
+};
+
+template<class FONT, uint16_t ROW, uint16_t COL, bool COL_END>
+struct lcdGlyphWriter<FONT, ROW, COL, true, COL_END> {
+	static MBED_FORCEINLINE void write(ILI9341 &lcd, const uint8_t *glyph, uint16_t color, uint16_t bg) {
+	}
+};
+
+template<class FONT>
+void ILI9341::drawChar(int16_t x, int16_t y, uint8_t c, uint16_t color, uint16_t bg) {
+	LCD_LOCK(*this);
+	x += Clip.originX;
+	y += Clip.originY;
+	if (bg == color || x < Clip.x0 || y < Clip.y0
+			|| x + FONT::Width - 1 > Clip.x1
+			|| y + FONT::Height - 1 > Clip.y1) {
+		drawGlyph(FONT::font(), 1, x, y, c, color, bg);
+		return;
+	}
+
+	setWindow(x, y, x + FONT::Width - 1, y + FONT::Height - 1);
+	lcdGlyphWriter<FONT>::write(*this, FONT::glyph(c), color, bg);
+}
+
+template<class FONT>
+void ILI9341::drawString(int16_t x, int16_t y, const char *text, uint16_t color, uint16_t bg) {
+	LCD_LOCK(*this);
+	for (; *text && x + Clip.originX <= Clip.x1; text++, x += FONT::Width) {
+		drawChar<FONT>(x, y, *text, color, bg);
+	}
+}
+
 #endif  /* _ILI9341_H_ */
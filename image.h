@@ -35,6 +35,16 @@ typedef struct {
 	const uint8_t *pData;
 } sImage_t;
 
+/**
+ * @brief  Opaque runs of an image with a transparent color.
+ *         For each row: number of runs, then start and length of each run.
+ *         Made offline with tools/imageruns.py, or at run time with lcdImageRuns.
+ */
+typedef struct {
+	const sImage_t *image;
+	const uint16_t *runs;
+} sImageRuns_t;
+
 extern const sImage_t bmSTLogo;
 
 #endif /* _IMAGE_H_ */
@@ -0,0 +1,374 @@
+/**  
+* @file renderqueue.cpp  
+* @brief Queue of drawings for a ILI9341 display, posted without
+* blocking and drawn by a display thread
+*  
+* @author Marcelo H Moraes 
+* 
+* @date 10/18/2026
+*
+* Copyright (c) 2021, Marcelo H Moraes
+* SPDX-License-Identifier: Apache-2.0
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+*
+* You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied.
+*
+* See the License for the specific language governing permissions and limitations under the License.
+*/ 
+
+#include <stdio.h>
+#include <string.h>
+#include "renderqueue.h"
+
+#define LCD_RENDER_WAKE		0x01    // Thread flag of the display thread, set by posts
+#define LCD_RENDER_DIGITS	11      // Widest number from interrupts, as INT32_MIN
+
+/* --- Public methods --- */
+
+ILI9341RenderQueue::ILI9341RenderQueue(ILI9341 &display, osPriority_t priority, uint32_t stackSize)
+		: _display(display), _changed(_mutex), _thread(priority, stackSize) {
+	memset(&_stats, 0, sizeof(_stats));
+	// Numbers posted before setIsrTextState use the font of the display
+	_isrTextState = display.getTextState();
+	// Slot i is free for the post number i
+	for (uint32_t i = 0; i < LCD_RENDER_ISR_QUEUE_SIZE; i++)
+		_isrSlots[i].sequence = i;
+}
+
+bool ILI9341RenderQueue::start(void) {
+	if (_thread.start(mbed::callback(this, &ILI9341RenderQueue::run)) != osOK)
+		return false;
+	// Posts only set the flag of a running thread. One set here covers a post
+	// made after the first process of the thread but before this line
+	_started = true;
+	_thread.flags_set(LCD_RENDER_WAKE);
+	return true;
+}
+
+uint16_t ILI9341RenderQueue::process(void) {
+	lcdRenderCommand_t batch[LCD_RENDER_BATCH];
+	lcdRenderIsrCommand_t isrBatch[LCD_RENDER_BATCH];
+	uint16_t count = 0, isrCount = 0;
+
+	// Commands are copied out, so producers can post while they are drawn
+	_mutex.lock();
+	for (; count < LCD_RENDER_BATCH && _tail != _head; count++, _tail++)
+		batch[count] = _commands[_tail % LCD_RENDER_QUEUE_SIZE];
+	while (isrCount < LCD_RENDER_BATCH && takeFromIsr(&isrBatch[isrCount]))
+		isrCount++;
+	_mutex.unlock();
+
+	if (count == 0 && isrCount == 0)
+		return 0;
+
+	_display.lock();
+	for (uint16_t i = 0; i < isrCount; i++)
+		executeFromIsr(&isrBatch[i]);
+	for (uint16_t i = 0; i < count; i++)
+		execute(&batch[i]);
+	_display.unlock();
+
+	if (count == 0)
+		return isrCount;
+
+	uint32_t now = us_ticker_read();
+	_mutex.lock();
+	for (uint16_t i = 0; i < count; i++) {
+		uint32_t latency = now - batch[i].posted;
+		if (latency > _stats.maxLatency)
+			_stats.maxLatency = latency;
+		_stats.lastLatency = latency;
+	}
+	_completed = batch[count - 1].token;
+	_stats.completed += count;
+	_changed.notify_all();
+	_mutex.unlock();
+	return count + isrCount;
+}
+
+uint32_t ILI9341RenderQueue::fillScreen(uint16_t color) {
+	lcdRenderCommand_t command;
+	command.type = LCD_RENDER_FILL_SCREEN;
+	command.color = color;
+	return post(&command);
+}
+
+uint32_t ILI9341RenderQueue::fillRect(int16_t x, int16_t y, int16_t width, int16_t height, uint16_t color) {
+	lcdRenderCommand_t command;
+	command.type = LCD_RENDER_FILL_RECT;
+	command.shape.x0 = x;
+	command.shape.y0 = y;
+	command.shape.x1 = width;
+	command.shape.y1 = height;
+	command.shape.color = color;
+	return post(&command);
+}
+
+uint32_t ILI9341RenderQueue::drawRect(int16_t x, int16_t y, int16_t width, int16_t height, uint16_t color) {
+	lcdRenderCommand_t command;
+	command.type = LCD_RENDER_DRAW_RECT;
+	command.shape.x0 = x;
+	command.shape.y0 = y;
+	command.shape.x1 = width;
+	command.shape.y1 = height;
+	command.shape.color = color;
+	return post(&command);
+}
+
+uint32_t ILI9341RenderQueue::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+	lcdRenderCommand_t command;
+	command.type = LCD_RENDER_DRAW_LINE;
+	command.shape.x0 = x0;
+	command.shape.y0 = y0;
+	command.shape.x1 = x1;
+	command.shape.y1 = y1;
+	command.shape.color = color;
+	return post(&command);
+}
+
+uint32_t ILI9341RenderQueue::drawImage(int16_t x, int16_t y, const sImage_t *image) {
+	lcdRenderCommand_t command;
+	command.type = LCD_RENDER_DRAW_IMAGE;
+	command.image.x = x;
+	command.image.y = y;
+	command.image.image = image;
+	return post(&command);
+}
+
+uint32_t ILI9341RenderQueue::drawText(int16_t x, int16_t y, const char *text, const lcdTextState_t *state) {
+	lcdRenderCommand_t command;
+	command.type = LCD_RENDER_DRAW_TEXT;
+	command.text.x = x;
+	command.text.y = y;
+	command.text.state = *state;
+	strncpy(command.text.text, text, LCD_RENDER_TEXT_SIZE - 1);
+	command.text.text[LCD_RENDER_TEXT_SIZE - 1] = '\0';
+	return post(&command);
+}
+
+uint32_t ILI9341RenderQueue::call(lcdRenderFunction_t function, void *argument) {
+	lcdRenderCommand_t command;
+	command.type = LCD_RENDER_CALL;
+	command.call.function = function;
+	command.call.argument = argument;
+	return post(&command);
+}
+
+uint32_t ILI9341RenderQueue::fence(void) {
+	lcdRenderCommand_t command;
+	command.type = LCD_RENDER_FENCE;
+	return post(&command);
+}
+
+bool ILI9341RenderQueue::isDone(uint32_t token) {
+	_mutex.lock();
+	// Tokens wrap, the difference keeps the order
+	bool done = (int32_t)(_completed - token) >= 0;
+	_mutex.unlock();
+	return done;
+}
+
+bool ILI9341RenderQueue::wait(uint32_t token, uint32_t timeout) {
+	uint32_t start = us_ticker_read();
+	bool done;
+
+	_mutex.lock();
+	while (!(done = (int32_t)(_completed - token) >= 0)) {
+		if (timeout == osWaitForever) {
+			_changed.wait();
+			continue;
+		}
+		uint32_t elapsed = (us_ticker_read() - start) / 1000;
+		if (elapsed >= timeout)
+			break;
+		_changed.wait_for(Kernel::Clock::duration_u32(timeout - elapsed));
+	}
+	_mutex.unlock();
+	return done;
+}
+
+void ILI9341RenderQueue::setIsrTextState(const lcdTextState_t *state) {
+	_mutex.lock();
+	_isrTextState = *state;
+	_mutex.unlock();
+}
+
+bool ILI9341RenderQueue::fillRectFromIsr(int16_t x, int16_t y, int16_t width, int16_t height, uint16_t color) {
+	lcdRenderIsrCommand_t command;
+	command.type = LCD_RENDER_ISR_FILL_RECT;
+	command.color = color;
+	command.x = x;
+	command.y = y;
+	command.size.width = width;
+	command.size.height = height;
+	return postFromIsr(&command);
+}
+
+bool ILI9341RenderQueue::drawNumberFromIsr(int16_t x, int16_t y, int32_t value, uint8_t digits) {
+	lcdRenderIsrCommand_t command;
+	command.type = LCD_RENDER_ISR_NUMBER;
+	command.digits = (digits > LCD_RENDER_DIGITS) ? LCD_RENDER_DIGITS : digits;
+	command.x = x;
+	command.y = y;
+	command.value = value;
+	return postFromIsr(&command);
+}
+
+bool ILI9341RenderQueue::callFromIsr(lcdRenderFunction_t function, void *argument) {
+	lcdRenderIsrCommand_t command;
+	command.type = LCD_RENDER_ISR_CALL;
+	command.call.function = function;
+	command.call.argument = argument;
+	return postFromIsr(&command);
+}
+
+lcdRenderStats_t ILI9341RenderQueue::getStats(void) {
+	_mutex.lock();
+	lcdRenderStats_t stats = _stats;
+	stats.depth = _head - _tail;
+	stats.isrPosted = core_util_atomic_load_u32(&_isrPosted);
+	stats.isrRejected = core_util_atomic_load_u32(&_isrRejected);
+	_mutex.unlock();
+	return stats;
+}
+
+void ILI9341RenderQueue::resetStats(void) {
+	_mutex.lock();
+	_stats.maxDepth = _head - _tail;
+	_stats.maxLatency = 0;
+	_mutex.unlock();
+}
+
+/* --- Protected methods --- */
+
+uint32_t ILI9341RenderQueue::post(lcdRenderCommand_t *command) {
+	uint32_t token = 0;
+
+	_mutex.lock();
+	if (_head - _tail >= LCD_RENDER_QUEUE_SIZE) {
+		_stats.rejected++;
+	} else {
+		// Token 0 means full, it is skipped when the counter wraps
+		if (++_token == 0)
+			_token = 1;
+		token = command->token = _token;
+		command->posted = us_ticker_read();
+		_commands[_head++ % LCD_RENDER_QUEUE_SIZE] = *command;
+		_stats.posted++;
+		if (_head - _tail > _stats.maxDepth)
+			_stats.maxDepth = _head - _tail;
+		_changed.notify_all();
+	}
+	_mutex.unlock();
+	if (token && _started)
+		_thread.flags_set(LCD_RENDER_WAKE);
+	return token;
+}
+
+bool ILI9341RenderQueue::postFromIsr(const lcdRenderIsrCommand_t *command) {
+	uint32_t position = core_util_atomic_load_u32(&_isrHead);
+	lcdRenderIsrSlot_t *slot;
+
+	// Reserve a slot, the compare fails only if a higher interrupt posted meanwhile
+	while (true) {
+		slot = &_isrSlots[position % LCD_RENDER_ISR_QUEUE_SIZE];
+		int32_t difference = (int32_t)(core_util_atomic_load_u32(&slot->sequence) - position);
+		if (difference < 0) {
+			// Slot still holds a command not drawn, the ring is full
+			core_util_atomic_incr_u32(&_isrRejected, 1);
+			return false;
+		}
+		if (difference == 0 && core_util_atomic_cas_u32(&_isrHead, &position, position + 1))
+			break;
+		if (difference > 0)
+			position = core_util_atomic_load_u32(&_isrHead);
+	}
+
+	// The sequence store publishes the command to process
+	slot->command = *command;
+	core_util_atomic_store_u32(&slot->sequence, position + 1);
+	core_util_atomic_incr_u32(&_isrPosted, 1);
+	if (_started)
+		_thread.flags_set(LCD_RENDER_WAKE);
+	return true;
+}
+
+bool ILI9341RenderQueue::takeFromIsr(lcdRenderIsrCommand_t *command) {
+	lcdRenderIsrSlot_t *slot = &_isrSlots[_isrTail % LCD_RENDER_ISR_QUEUE_SIZE];
+
+	// Empty, or the next slot is reserved but its interrupt did not finish
+	if (core_util_atomic_load_u32(&slot->sequence) != _isrTail + 1)
+		return false;
+
+	*command = slot->command;
+	core_util_atomic_store_u32(&slot->sequence, _isrTail + LCD_RENDER_ISR_QUEUE_SIZE);
+	_isrTail++;
+	return true;
+}
+
+void ILI9341RenderQueue::execute(const lcdRenderCommand_t *command) {
+	switch (command->type) {
+	case LCD_RENDER_FILL_SCREEN:
+		_display.fillScreen(command->color);
+		break;
+	case LCD_RENDER_FILL_RECT:
+		_display.fillRect(command->shape.x0, command->shape.y0, command->shape.x1, command->shape.y1,
+				command->shape.color);
+		break;
+	case LCD_RENDER_DRAW_RECT:
+		_display.drawRect(command->shape.x0, command->shape.y0, command->shape.x1, command->shape.y1,
+				command->shape.color);
+		break;
+	case LCD_RENDER_DRAW_LINE:
+		_display.drawLine(command->shape.x0, command->shape.y0, command->shape.x1, command->shape.y1,
+				command->shape.color);
+		break;
+	case LCD_RENDER_DRAW_IMAGE:
+		_display.drawImage(command->image.x, command->image.y, command->image.image);
+		break;
+	case LCD_RENDER_DRAW_TEXT:
+		_display.drawText(&command->text.state, command->text.x, command->text.y, 0, command->text.text);
+		break;
+	case LCD_RENDER_CALL:
+		command->call.function(_display, command->call.argument);
+		break;
+	default:
+		break;
+	}
+}
+
+void ILI9341RenderQueue::executeFromIsr(const lcdRenderIsrCommand_t *command) {
+	char text[LCD_RENDER_DIGITS + 1];
+	int digits;
+
+	switch (command->type) {
+	case LCD_RENDER_ISR_FILL_RECT:
+		_display.fillRect(command->x, command->y, command->size.width, command->size.height, command->color);
+		break;
+	case LCD_RENDER_ISR_NUMBER:
+		// Clamped again so the compiler sees the field fits the text
+		digits = (command->digits > LCD_RENDER_DIGITS) ? LCD_RENDER_DIGITS : command->digits;
+		snprintf(text, sizeof(text), "%*ld", digits, (long)command->value);
+		_display.drawText(&_isrTextState, command->x, command->y, 0, text);
+		break;
+	case LCD_RENDER_ISR_CALL:
+		command->call.function(_display, command->call.argument);
+		break;
+	default:
+		break;
+	}
+}
+
+void ILI9341RenderQueue::run(void) {
+	// A post between an empty process and the wait leaves the flag set
+	while (true) {
+		if (process() == 0)
+			rtos::ThisThread::flags_wait_any(LCD_RENDER_WAKE);
+	}
+}
@@ -0,0 +1,358 @@
+/**  
+* @file renderqueue.h  
+* @brief Queue of drawings for a ILI9341 display, posted without
+* blocking and drawn by a display thread
+*  
+* @author Marcelo H Moraes 
+* 
+* @date 10/18/2026
+*
+* Copyright (c) 2021, Marcelo H Moraes
+* SPDX-License-Identifier: Apache-2.0
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+*
+* You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied.
+*
+* See the License for the specific language governing permissions and limitations under the License.
+*/ 
+
+#ifndef _RENDERQUEUE_H_
+#define _RENDERQUEUE_H_
+
+#include "ili9341.h"
+
+#ifndef LCD_RENDER_QUEUE_SIZE
+#define LCD_RENDER_QUEUE_SIZE	32     // Power of two, the counters wrap at 2^32
+#endif
+
+static_assert((LCD_RENDER_QUEUE_SIZE & (LCD_RENDER_QUEUE_SIZE - 1)) == 0,
+		"LCD_RENDER_QUEUE_SIZE must be a power of two");
+
+#ifndef LCD_RENDER_BATCH
+#define LCD_RENDER_BATCH		8      // Commands drawn for each lock of the display
+#endif
+
+#ifndef LCD_RENDER_ISR_QUEUE_SIZE
+#define LCD_RENDER_ISR_QUEUE_SIZE	16     // Power of two, the slot sequences wrap at 2^32
+#endif
+
+static_assert((LCD_RENDER_ISR_QUEUE_SIZE & (LCD_RENDER_ISR_QUEUE_SIZE - 1)) == 0,
+		"LCD_RENDER_ISR_QUEUE_SIZE must be a power of two");
+
+#ifndef LCD_RENDER_TEXT_SIZE
+#define LCD_RENDER_TEXT_SIZE	32     // Longer texts are cut
+#endif
+
+/**
+ * @brief  Kind of a queued drawing
+ */
+typedef enum {
+	LCD_RENDER_FENCE = 0,
+	LCD_RENDER_FILL_SCREEN,
+	LCD_RENDER_FILL_RECT,
+	LCD_RENDER_DRAW_RECT,
+	LCD_RENDER_DRAW_LINE,
+	LCD_RENDER_DRAW_IMAGE,
+	LCD_RENDER_DRAW_TEXT,
+	LCD_RENDER_CALL
+} lcdRenderType_t;
+
+/**
+ * @brief  Function drawn by the display thread
+ */
+typedef void (*lcdRenderFunction_t)(ILI9341 &display, void *argument);
+
+/**
+ * @brief  One queued drawing, with copies of its arguments
+ */
+typedef struct {
+	uint32_t token;
+	uint32_t posted;        // us_ticker time when queued
+	uint8_t type;
+	union {
+		uint16_t color;
+		struct {
+			int16_t x0;
+			int16_t y0;
+			int16_t x1;         // Width for rectangles
+			int16_t y1;         // Height for rectangles
+			uint16_t color;
+		} shape;
+		struct {
+			int16_t x;
+			int16_t y;
+			const sImage_t *image;
+		} image;
+		struct {
+			int16_t x;
+			int16_t y;
+			lcdTextState_t state;
+			char text[LCD_RENDER_TEXT_SIZE];
+		} text;
+		struct {
+			lcdRenderFunction_t function;
+			void *argument;
+		} call;
+	};
+} lcdRenderCommand_t;
+
+/**
+ * @brief  Kind of a drawing posted from an interrupt
+ */
+typedef enum {
+	LCD_RENDER_ISR_FILL_RECT = 0,   // Indicator
+	LCD_RENDER_ISR_NUMBER,
+	LCD_RENDER_ISR_CALL
+} lcdRenderIsrType_t;
+
+/**
+ * @brief  Drawing posted from an interrupt, small to be copied in a few cycles
+ */
+typedef struct {
+	uint8_t type;
+	uint8_t digits;         // Field width of numbers
+	uint16_t color;
+	int16_t x;
+	int16_t y;
+	union {
+		struct {
+			int16_t width;
+			int16_t height;
+		} size;
+		int32_t value;
+		struct {
+			lcdRenderFunction_t function;
+			void *argument;
+		} call;
+	};
+} lcdRenderIsrCommand_t;
+
+/**
+ * @brief  Slot of the interrupt ring, the sequence tells who owns it
+ */
+typedef struct {
+	volatile uint32_t sequence;
+	lcdRenderIsrCommand_t command;
+} lcdRenderIsrSlot_t;
+
+/**
+ * @brief  Queue statistics, latencies in microseconds from post to drawn
+ */
+typedef struct {
+	uint16_t depth;         // Commands waiting now
+	uint16_t maxDepth;
+	uint32_t posted;
+	uint32_t completed;
+	uint32_t rejected;      // Posts refused because the queue was full
+	uint32_t lastLatency;
+	uint32_t maxLatency;
+	uint32_t isrPosted;     // Commands posted from interrupts
+	uint32_t isrRejected;   // Interrupt posts refused because the ring was full
+} lcdRenderStats_t;
+
+/**
+ * @brief Drawings posted by any thread without waiting for the display.
+ *        Commands are copied to a fixed ring and a low priority thread, or
+ *        process called from an EventQueue, draws them in batches.
+ *        Each post returns a token, 0 when the queue is full, that can be
+ *        waited or tested to know when the drawing and all before it are done.
+ *        Images must be kept until their drawing is done, texts are copied.
+ *        Interrupts post to a separate lock free ring with the FromIsr
+ *        functions, a full ring refuses the new command and counts it.
+ *
+ * @code
+ * ILI9341RenderQueue queue(display);
+ * queue.start();
+ * queue.fillRect(0, 0, 100, 20, BLUE);
+ * uint32_t token = queue.drawImage(10, 40, &bmLogo);
+ * queue.wait(token);
+ * @endcode
+ */
+class ILI9341RenderQueue {
+	friend class ILI9341TaskScheduler;
+
+protected:
+
+	ILI9341 &_display;
+	rtos::Mutex _mutex;
+	rtos::ConditionVariable _changed;   // Commands posted or completed
+	rtos::Thread _thread;
+	bool _started = false;
+	lcdRenderCommand_t _commands[LCD_RENDER_QUEUE_SIZE];
+	uint32_t _head = 0;                 // Commands posted
+	uint32_t _tail = 0;                 // Commands taken to draw
+	uint32_t _token = 0;                // Last token given
+	uint32_t _completed = 0;            // Last token drawn
+	lcdRenderStats_t _stats;
+	lcdRenderIsrSlot_t _isrSlots[LCD_RENDER_ISR_QUEUE_SIZE];
+	volatile uint32_t _isrHead = 0;     // Slots reserved by interrupts
+	uint32_t _isrTail = 0;              // Slots taken, only by process
+	volatile uint32_t _isrPosted = 0;
+	volatile uint32_t _isrRejected = 0;
+	lcdTextState_t _isrTextState;
+
+	uint32_t post(lcdRenderCommand_t *command);
+	bool postFromIsr(const lcdRenderIsrCommand_t *command);
+	bool takeFromIsr(lcdRenderIsrCommand_t *command);
+	void execute(const lcdRenderCommand_t *command);
+	void executeFromIsr(const lcdRenderIsrCommand_t *command);
+	void run(void);
+
+public:
+
+	/**
+	 * @brief Create an empty queue for a display
+	 *
+	 * @param display		Display where the commands are drawn
+	 * @param priority		Priority of the display thread
+	 * @param stackSize		Stack of the display thread
+	 */
+	ILI9341RenderQueue(ILI9341 &display, osPriority_t priority = osPriorityLow,
+			uint32_t stackSize = OS_STACK_SIZE);
+
+	/**
+	 * @brief Start the display thread. Not needed when process is called
+	 *        from another thread or an EventQueue
+	 *
+	 * @return bool		false if the thread could not start
+	 */
+	bool start(void);
+
+	/**
+	 * @brief Draw the commands waiting, with the display locked once for each batch.
+	 *        Interrupt posts don't wake an EventQueue, it must call this periodically
+	 *
+	 * @return uint16_t	Number of commands drawn
+	 */
+	uint16_t process(void);
+
+	/**
+	 * @brief Queue a fill of the screen
+	 *
+	 * @return uint32_t	Token, 0 if the queue is full
+	 */
+	uint32_t fillScreen(uint16_t color);
+
+	/**
+	 * @brief Queue a filled rectangle
+	 *
+	 * @return uint32_t	Token, 0 if the queue is full
+	 */
+	uint32_t fillRect(int16_t x, int16_t y, int16_t width, int16_t height, uint16_t color);
+
+	/**
+	 * @brief Queue a rectangle outline
+	 *
+	 * @return uint32_t	Token, 0 if the queue is full
+	 */
+	uint32_t drawRect(int16_t x, int16_t y, int16_t width, int16_t height, uint16_t color);
+
+	/**
+	 * @brief Queue a line
+	 *
+	 * @return uint32_t	Token, 0 if the queue is full
+	 */
+	uint32_t drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color);
+
+	/**
+	 * @brief Queue an image, it must be kept until the drawing is done
+	 *
+	 * @return uint32_t	Token, 0 if the queue is full
+	 */
+	uint32_t drawImage(int16_t x, int16_t y, const sImage_t *image);
+
+	/**
+	 * @brief Queue a text with the font and colors of a text state
+	 *
+	 * @return uint32_t	Token, 0 if the queue is full
+	 */
+	uint32_t drawText(int16_t x, int16_t y, const char *text, const lcdTextState_t *state);
+
+	/**
+	 * @brief Queue a function, called with the display by the display thread
+	 *
+	 * @return uint32_t	Token, 0 if the queue is full
+	 */
+	uint32_t call(lcdRenderFunction_t function, void *argument);
+
+	/**
+	 * @brief Queue a mark that is done when all commands before it are done
+	 *
+	 * @return uint32_t	Token, 0 if the queue is full
+	 */
+	uint32_t fence(void);
+
+	/**
+	 * @brief Whether the command of a token, and all before it, were drawn
+	 *
+	 * @return bool
+	 */
+	bool isDone(uint32_t token);
+
+	/**
+	 * @brief Wait the command of a token to be drawn
+	 *
+	 * @param token		Token returned by a post
+	 * @param timeout	Milliseconds to wait, osWaitForever to wait without limit
+	 *
+	 * @return bool		false on timeout
+	 */
+	bool wait(uint32_t token, uint32_t timeout = osWaitForever);
+
+	/**
+	 * @brief Set the font and colors of numbers posted from interrupts,
+	 *        by default those of the display when the queue was created.
+	 *        Call it before the interrupts are enabled
+	 *
+	 * @return void
+	 */
+	void setIsrTextState(const lcdTextState_t *state);
+
+	/**
+	 * @brief Post a filled rectangle from an interrupt, as a status indicator
+	 *
+	 * @return bool		false if the ring is full
+	 */
+	bool fillRectFromIsr(int16_t x, int16_t y, int16_t width, int16_t height, uint16_t color);
+
+	/**
+	 * @brief Post a number from an interrupt, right aligned in a field
+	 *        and drawn with the text state of setIsrTextState
+	 *
+	 * @param digits	Field width in characters, up to 11
+	 *
+	 * @return bool		false if the ring is full
+	 */
+	bool drawNumberFromIsr(int16_t x, int16_t y, int32_t value, uint8_t digits);
+
+	/**
+	 * @brief Post a function from an interrupt, called with the display
+	 *        by the display thread
+	 *
+	 * @return bool		false if the ring is full
+	 */
+	bool callFromIsr(lcdRenderFunction_t function, void *argument);
+
+	/**
+	 * @brief Get the statistics of the queue
+	 *
+	 * @return lcdRenderStats_t
+	 */
+	lcdRenderStats_t getStats(void);
+
+	/**
+	 * @brief Clear the maximum depth and latency
+	 *
+	 * @return void
+	 */
+	void resetStats(void);
+
+};
+
+#endif  /* _RENDERQUEUE_H_ */
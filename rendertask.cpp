@@ -0,0 +1,210 @@
+/**
+* @file rendertask.cpp
+* @brief Coroutines that draw through a ILI9341 render queue,
+* suspended while the display thread draws
+*
+* @author Marcelo H Moraes
+*
+* @date 10/18/2026
+*
+* Copyright (c) 2021, Marcelo H Moraes
+* SPDX-License-Identifier: Apache-2.0
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+*
+* You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied.
+*
+* See the License for the specific language governing permissions and limitations under the License.
+*/
+
+#include "rendertask.h"
+
+#if defined(__cpp_impl_coroutine)
+
+#if LCD_TASK_POOL_COUNT > 32
+#error "LCD_TASK_POOL_COUNT must be up to 32"
+#endif
+
+#ifdef LCD_THREAD_SAFE
+static void lcdTaskFlushConsole(ILI9341 &, void *argument);
+#endif
+
+// Frames of the coroutines, a bit of lcdTaskUsed for each one
+alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) static uint8_t lcdTaskFrames[LCD_TASK_POOL_COUNT][LCD_TASK_FRAME_SIZE];
+static volatile uint32_t lcdTaskUsed = 0;
+
+/* --- Public methods --- */
+
+void *ILI9341Task::promise_type::operator new(size_t size) noexcept {
+	if (size > LCD_TASK_FRAME_SIZE)
+		return nullptr;
+	// Lock free, tasks can be created by any thread
+	uint32_t used = core_util_atomic_load_u32(&lcdTaskUsed);
+	for (;;) {
+		uint8_t index = 0;
+		while (index < LCD_TASK_POOL_COUNT && (used & (1UL << index)))
+			index++;
+		if (index == LCD_TASK_POOL_COUNT)
+			return nullptr;
+		if (core_util_atomic_cas_u32(&lcdTaskUsed, &used, used | (1UL << index)))
+			return lcdTaskFrames[index];
+	}
+}
+
+void ILI9341Task::promise_type::operator delete(void *frame) noexcept {
+	uint32_t index = ((uint8_t *) frame - &lcdTaskFrames[0][0]) / LCD_TASK_FRAME_SIZE;
+	uint32_t used = core_util_atomic_load_u32(&lcdTaskUsed);
+	while (!core_util_atomic_cas_u32(&lcdTaskUsed, &used, used & ~(1UL << index)))
+		;
+}
+
+std::coroutine_handle<> ILI9341Task::FinalAwaiter::await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+	promise_type &promise = handle.promise();
+
+	// The awaiting task frees this one when its ILI9341Task is destroyed
+	if (promise.continuation)
+		return promise.continuation;
+	ILI9341TaskScheduler *scheduler = promise.scheduler;
+	handle.destroy();
+	if (scheduler)
+		scheduler->_tasks--;
+	return std::noop_coroutine();
+}
+
+ILI9341DrawAwaiter::ILI9341DrawAwaiter(ILI9341TaskScheduler &scheduler, const lcdRenderCommand_t *command)
+		: _scheduler(scheduler), _command(*command) {
+	_command.token = 0;
+}
+
+void ILI9341DrawAwaiter::await_suspend(std::coroutine_handle<> handle) {
+	_handle = handle;
+	_scheduler.suspend(this);
+}
+
+ILI9341TaskScheduler::ILI9341TaskScheduler(ILI9341RenderQueue &queue) : _queue(queue) {
+}
+
+bool ILI9341TaskScheduler::spawn(ILI9341Task task) {
+	if (!task._handle)
+		return false;
+	std::coroutine_handle<ILI9341Task::promise_type> handle = task._handle;
+	task._handle = nullptr;
+	handle.promise().scheduler = this;
+	_tasks++;
+	handle.resume();
+	return true;
+}
+
+uint16_t ILI9341TaskScheduler::poll(void) {
+	ILI9341DrawAwaiter *ready = nullptr, **readyLast = &ready;
+	ILI9341DrawAwaiter **link = &_waiting;
+	bool full = false;
+
+	while (*link) {
+		ILI9341DrawAwaiter *awaiter = *link;
+		// Once the queue refuses one, the others wait the next poll
+		if (!awaiter->_command.token && !full)
+			full = !_queue.post(&awaiter->_command);
+		if (awaiter->_command.token && _queue.isDone(awaiter->_command.token)) {
+			*link = awaiter->_next;
+			awaiter->_next = nullptr;
+			*readyLast = awaiter;
+			readyLast = &awaiter->_next;
+		} else {
+			link = &awaiter->_next;
+		}
+	}
+	// Resumed after the walk, a task can await again and the awaiter is gone
+	while (ready) {
+		ILI9341DrawAwaiter *awaiter = ready;
+		ready = awaiter->_next;
+		awaiter->_handle.resume();
+	}
+	return _tasks;
+}
+
+void ILI9341TaskScheduler::run(void) {
+	while (poll()) {
+		// Tokens are done in order, the oldest is the first to resume a task
+		uint32_t token = 0;
+		for (ILI9341DrawAwaiter *awaiter = _waiting; awaiter; awaiter = awaiter->_next) {
+			if (awaiter->_command.token && (!token || (int32_t) (awaiter->_command.token - token) < 0))
+				token = awaiter->_command.token;
+		}
+		if (token)
+			_queue.wait(token);
+		else
+			rtos::ThisThread::sleep_for(Kernel::Clock::duration_u32(1));   // Queue full
+	}
+}
+
+ILI9341DrawAwaiter ILI9341TaskScheduler::fillScreen(uint16_t color) {
+	lcdRenderCommand_t command;
+	command.type = LCD_RENDER_FILL_SCREEN;
+	command.color = color;
+	return ILI9341DrawAwaiter(*this, &command);
+}
+
+ILI9341DrawAwaiter ILI9341TaskScheduler::fillRect(int16_t x, int16_t y, int16_t width, int16_t height,
+		uint16_t color) {
+	lcdRenderCommand_t command;
+	command.type = LCD_RENDER_FILL_RECT;
+	command.shape.x0 = x;
+	command.shape.y0 = y;
+	command.shape.x1 = width;
+	command.shape.y1 = height;
+	command.shape.color = color;
+	return ILI9341DrawAwaiter(*this, &command);
+}
+
+ILI9341DrawAwaiter ILI9341TaskScheduler::drawImage(int16_t x, int16_t y, const sImage_t *image) {
+	lcdRenderCommand_t command;
+	command.type = LCD_RENDER_DRAW_IMAGE;
+	command.image.x = x;
+	command.image.y = y;
+	command.image.image = image;
+	return ILI9341DrawAwaiter(*this, &command);
+}
+
+ILI9341DrawAwaiter ILI9341TaskScheduler::flush(void) {
+	lcdRenderCommand_t command;
+	command.type = LCD_RENDER_FENCE;
+	return ILI9341DrawAwaiter(*this, &command);
+}
+
+#ifdef LCD_THREAD_SAFE
+ILI9341DrawAwaiter ILI9341TaskScheduler::flush(ILI9341Console &console) {
+	lcdRenderCommand_t command;
+	command.type = LCD_RENDER_CALL;
+	command.call.function = lcdTaskFlushConsole;
+	command.call.argument = &console;
+	return ILI9341DrawAwaiter(*this, &command);
+}
+#endif
+
+/* --- Protected methods --- */
+
+void ILI9341TaskScheduler::suspend(ILI9341DrawAwaiter *awaiter) {
+	ILI9341DrawAwaiter **link = &_waiting;
+
+	// Posted now, if the queue is full poll tries again
+	_queue.post(&awaiter->_command);
+	while (*link)
+		link = &(*link)->_next;
+	*link = awaiter;
+}
+
+/* --- Static functions --- */
+
+#ifdef LCD_THREAD_SAFE
+static void lcdTaskFlushConsole(ILI9341 &, void *argument) {
+	((ILI9341Console *) argument)->flush();
+}
+#endif
+
+#endif  /* __cpp_impl_coroutine */
@@ -0,0 +1,260 @@
+/**
+* @file rendertask.h
+* @brief Coroutines that draw through a ILI9341 render queue,
+* suspended while the display thread draws
+*
+* @author Marcelo H Moraes
+*
+* @date 10/18/2026
+*
+* Copyright (c) 2021, Marcelo H Moraes
+* SPDX-License-Identifier: Apache-2.0
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+*
+* You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied.
+*
+* See the License for the specific language governing permissions and limitations under the License.
+*/
+
+#ifndef _RENDERTASK_H_
+#define _RENDERTASK_H_
+
+// Only with compilers that have C++20 coroutines, as -std=c++20 with GCC 10 or newer
+#if defined(__cpp_impl_coroutine)
+
+#pragma push_macro("swap")
+#undef swap
+#include <coroutine>
+#pragma pop_macro("swap")
+
+#include "renderqueue.h"
+#include "console.h"
+
+#ifndef LCD_TASK_POOL_COUNT
+#define LCD_TASK_POOL_COUNT		8      // Coroutines alive at same time, up to 32
+#endif
+
+#ifndef LCD_TASK_FRAME_SIZE
+#define LCD_TASK_FRAME_SIZE		512    // Bytes of each coroutine frame, with its locals and about 64 for each co_await
+#endif
+
+class ILI9341TaskScheduler;
+
+/**
+ * @brief Coroutine of drawings. Its frame comes from a static pool,
+ *        a coroutine that doesn't get a frame returns an invalid task
+ *        that spawn refuses and co_await skips
+ */
+class ILI9341Task {
+	friend class ILI9341TaskScheduler;
+
+public:
+
+	struct promise_type;
+
+	/**
+	 * @brief  Resume who awaited the task, or free the frame of a spawned task
+	 */
+	struct FinalAwaiter {
+		bool await_ready(void) noexcept { return false; }
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept;
+		void await_resume(void) noexcept {}
+	};
+
+	struct promise_type {
+		ILI9341TaskScheduler *scheduler = nullptr;   // Set for spawned tasks
+		std::coroutine_handle<> continuation;        // Set for awaited tasks
+
+		static void *operator new(size_t size) noexcept;
+		static void operator delete(void *frame) noexcept;
+		static ILI9341Task get_return_object_on_allocation_failure(void) { return ILI9341Task(nullptr); }
+
+		ILI9341Task get_return_object(void) {
+			return ILI9341Task(std::coroutine_handle<promise_type>::from_promise(*this));
+		}
+		std::suspend_always initial_suspend(void) noexcept { return {}; }
+		FinalAwaiter final_suspend(void) noexcept { return {}; }
+		void return_void(void) {}
+		void unhandled_exception(void) {}
+	};
+
+protected:
+
+	std::coroutine_handle<promise_type> _handle;
+
+	explicit ILI9341Task(std::coroutine_handle<promise_type> handle) : _handle(handle) {}
+
+public:
+
+	ILI9341Task(ILI9341Task &&task) : _handle(task._handle) { task._handle = nullptr; }
+	ILI9341Task(const ILI9341Task &) = delete;
+	ILI9341Task &operator=(const ILI9341Task &) = delete;
+	~ILI9341Task() { if (_handle) _handle.destroy(); }
+
+	/**
+	 * @brief Whether the coroutine got a frame from the pool
+	 *
+	 * @return bool
+	 */
+	bool isValid(void) const { return (bool) _handle; }
+
+	/**
+	 * @brief Await a task from another task, it runs until its first
+	 *        drawing and the caller is resumed when it returns
+	 *
+	 * @return bool		false if the task had no frame and did not run
+	 */
+	bool await_ready(void) const { return !_handle; }
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) {
+		_handle.promise().continuation = caller;
+		return _handle;
+	}
+	bool await_resume(void) const { return (bool) _handle; }
+
+};
+
+/**
+ * @brief Drawing awaited by a task, posted when the task suspends
+ *        and resumed by the scheduler when the drawing is done
+ */
+class ILI9341DrawAwaiter {
+	friend class ILI9341TaskScheduler;
+
+protected:
+
+	ILI9341TaskScheduler &_scheduler;
+	lcdRenderCommand_t _command;        // Token 0 until the queue takes it
+	std::coroutine_handle<> _handle;
+	ILI9341DrawAwaiter *_next = nullptr;
+
+public:
+
+	ILI9341DrawAwaiter(ILI9341TaskScheduler &scheduler, const lcdRenderCommand_t *command);
+
+	bool await_ready(void) { return false; }
+	void await_suspend(std::coroutine_handle<> handle);
+
+	/**
+	 * @return uint32_t	Token of the drawing
+	 */
+	uint32_t await_resume(void) { return _command.token; }
+
+};
+
+/**
+ * @brief Runs coroutines that draw through a render queue. A task posts
+ *        a drawing and suspends, other tasks run while the display thread
+ *        draws it, and the task is resumed when it is done.
+ *        Tasks of a scheduler run only in the thread that calls run or poll,
+ *        the queue must be started or processed by another thread.
+ *        Nothing is allocated from the heap, frames come from a pool of
+ *        LCD_TASK_POOL_COUNT blocks of LCD_TASK_FRAME_SIZE bytes.
+ *
+ * @code
+ * ILI9341Task splash(ILI9341TaskScheduler &ui) {
+ *     co_await ui.fillScreen(BLACK);
+ *     co_await ui.drawImage(60, 100, &bmLogo);
+ *     co_await ui.flush(console);      // With LCD_THREAD_SAFE
+ * }
+ *
+ * ILI9341TaskScheduler ui(queue);
+ * ui.spawn(splash(ui));
+ * ui.run();
+ * @endcode
+ */
+class ILI9341TaskScheduler {
+	friend class ILI9341Task;
+	friend class ILI9341DrawAwaiter;
+
+protected:
+
+	ILI9341RenderQueue &_queue;
+	ILI9341DrawAwaiter *_waiting = nullptr;    // In the order they were awaited
+	uint16_t _tasks = 0;                        // Spawned tasks not returned
+
+	void suspend(ILI9341DrawAwaiter *awaiter);
+
+public:
+
+	/**
+	 * @brief Create a scheduler for the tasks that draw through a queue
+	 *
+	 * @param queue		Queue where the drawings are posted
+	 */
+	ILI9341TaskScheduler(ILI9341RenderQueue &queue);
+
+	/**
+	 * @brief Run a task until its first drawing, the scheduler frees it when it returns
+	 *
+	 * @param task		Task returned by a coroutine
+	 *
+	 * @return bool		false if the task had no frame
+	 */
+	bool spawn(ILI9341Task task);
+
+	/**
+	 * @brief Post the drawings refused by a full queue and resume
+	 *        the tasks whose drawings are done, without waiting
+	 *
+	 * @return uint16_t	Number of tasks still running
+	 */
+	uint16_t poll(void);
+
+	/**
+	 * @brief Resume the tasks as their drawings are done, sleeping
+	 *        on the queue in between, until all tasks return
+	 *
+	 * @return void
+	 */
+	void run(void);
+
+	/**
+	 * @brief Await a fill of the screen
+	 *
+	 * @return ILI9341DrawAwaiter
+	 */
+	ILI9341DrawAwaiter fillScreen(uint16_t color);
+
+	/**
+	 * @brief Await a filled rectangle
+	 *
+	 * @return ILI9341DrawAwaiter
+	 */
+	ILI9341DrawAwaiter fillRect(int16_t x, int16_t y, int16_t width, int16_t height, uint16_t color);
+
+	/**
+	 * @brief Await an image, it must be kept until the task is resumed
+	 *
+	 * @return ILI9341DrawAwaiter
+	 */
+	ILI9341DrawAwaiter drawImage(int16_t x, int16_t y, const sImage_t *image);
+
+	/**
+	 * @brief Await all drawings posted before, by any thread
+	 *
+	 * @return ILI9341DrawAwaiter
+	 */
+	ILI9341DrawAwaiter flush(void);
+
+#ifdef LCD_THREAD_SAFE
+	/**
+	 * @brief Await the flush of a console by the display thread.
+	 *        Other tasks may write the console while it is drawn, so it
+	 *        needs LCD_THREAD_SAFE to share the display lock with the writes
+	 *
+	 * @return ILI9341DrawAwaiter
+	 */
+	ILI9341DrawAwaiter flush(ILI9341Console &console);
+#endif
+
+};
+
+#endif  /* __cpp_impl_coroutine */
+
+#endif  /* _RENDERTASK_H_ */
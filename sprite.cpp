@@ -0,0 +1,299 @@
+/**  
+* @file sprite.cpp  
+* @brief Sprites over a ILI9341 display, each one saves the
+* background it covers and restores it when it moves
+*  
+* @author Marcelo H Moraes 
+* 
+* @date 10/18/2026
+*
+* Copyright (c) 2021, Marcelo H Moraes
+* SPDX-License-Identifier: Apache-2.0
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+*
+* You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied.
+*
+* See the License for the specific language governing permissions and limitations under the License.
+*/ 
+
+#include <string.h>
+#include "sprite.h"
+
+/**
+ * @brief  Rectangle in screen coordinates, inclusive
+ */
+typedef struct {
+	int16_t x0;
+	int16_t y0;
+	int16_t x1;
+	int16_t y1;
+} lcdRect_t;
+
+/* --- Static functions prototypes --- */
+
+/*!
+ * @brief  Rectangle from its corners
+ */
+static lcdRect_t lcdMakeRect(int16_t x0, int16_t y0, int16_t x1, int16_t y1);
+
+/*!
+ * @brief  Rectangle covered by a sprite at a position
+ */
+static lcdRect_t lcdSpriteRect(const lcdSprite_t *sprite, int16_t x, int16_t y);
+
+/*!
+ * @brief  Whether two rectangles share pixels
+ */
+static bool lcdRectOverlaps(const lcdRect_t *a, const lcdRect_t *b);
+
+/*!
+ * @brief  Split the part of a outside of b in up to 4 rectangles, a and b must overlap
+ *
+ * @return uint8_t	Number of rectangles
+ */
+static uint8_t lcdRectSubtract(const lcdRect_t *a, const lcdRect_t *b, lcdRect_t *parts);
+
+/* --- Public methods --- */
+
+ILI9341Sprites::ILI9341Sprites(ILI9341 &display) : _display(display) {
+}
+
+int8_t ILI9341Sprites::add(const sImage_t *image, uint16_t *background, int16_t x, int16_t y, bool visible) {
+	if (_count == LCD_SPRITE_MAX)
+		return -1;
+
+	lcdSprite_t *sprite = &_sprites[_count];
+	sprite->image = image;
+	sprite->background = background;
+	sprite->nextX = x;
+	sprite->nextY = y;
+	sprite->flags = visible ? LCD_SPRITE_VISIBLE : 0;
+	return _count++;
+}
+
+void ILI9341Sprites::moveTo(uint8_t sprite, int16_t x, int16_t y) {
+	if (sprite >= _count)
+		return;
+	_sprites[sprite].nextX = x;
+	_sprites[sprite].nextY = y;
+}
+
+void ILI9341Sprites::setVisible(uint8_t sprite, bool visible) {
+	if (sprite >= _count)
+		return;
+	if (visible)
+		_sprites[sprite].flags |= LCD_SPRITE_VISIBLE;
+	else
+		_sprites[sprite].flags &= ~LCD_SPRITE_VISIBLE;
+}
+
+void ILI9341Sprites::setImage(uint8_t sprite, const sImage_t *image) {
+	if (sprite >= _count || _sprites[sprite].image == image)
+		return;
+	_sprites[sprite].image = image;
+	_sprites[sprite].flags |= LCD_SPRITE_CHANGED;
+}
+
+void ILI9341Sprites::hideAll(void) {
+	LCD_LOCK(_display);
+	// Top sprite first, each one saved what the ones below had drawn
+	for (uint8_t i = _count; i-- > 0;) {
+		if (_sprites[i].flags & LCD_SPRITE_DRAWN)
+			restore(&_sprites[i]);
+	}
+}
+
+uint8_t ILI9341Sprites::update(void) {
+	LCD_LOCK(_display);
+	const lcdClip_t &clip = _display.Clip;
+	uint8_t drawn = 0;
+	bool overlap = false;
+
+	for (uint8_t i = 0; i < _count && !overlap; i++)
+		overlap = overlapsOthers(i);
+
+	if (overlap) {
+		// Sprites over each other, all are taken out and drawn again in order
+		hideAll();
+		for (uint8_t i = 0; i < _count; i++) {
+			lcdSprite_t *sprite = &_sprites[i];
+			if (sprite->flags & LCD_SPRITE_VISIBLE) {
+				save(sprite, sprite->nextX + clip.originX, sprite->nextY + clip.originY);
+				draw(sprite);
+				drawn++;
+			}
+			sprite->flags &= ~LCD_SPRITE_CHANGED;
+		}
+		return drawn;
+	}
+
+	for (uint8_t i = 0; i < _count; i++) {
+		lcdSprite_t *sprite = &_sprites[i];
+		int16_t x = sprite->nextX + clip.originX;
+		int16_t y = sprite->nextY + clip.originY;
+		bool visible = sprite->flags & LCD_SPRITE_VISIBLE;
+		bool moved = !(sprite->flags & LCD_SPRITE_DRAWN) || sprite->x != x || sprite->y != y;
+
+		if (!visible) {
+			if (sprite->flags & LCD_SPRITE_DRAWN)
+				restore(sprite);
+		} else if (!(sprite->flags & LCD_SPRITE_DRAWN)) {
+			save(sprite, x, y);
+			draw(sprite);
+			drawn++;
+		} else if (moved) {
+			moveSprite(sprite, x, y);
+			draw(sprite);
+			drawn++;
+		} else if (sprite->flags & LCD_SPRITE_CHANGED) {
+			draw(sprite);
+			drawn++;
+		}
+		sprite->flags &= ~LCD_SPRITE_CHANGED;
+	}
+	return drawn;
+}
+
+/* --- Protected methods --- */
+
+bool ILI9341Sprites::overlapsOthers(uint8_t index) {
+	const lcdClip_t &clip = _display.Clip;
+	const lcdSprite_t *sprite = &_sprites[index];
+	lcdRect_t rects[2];
+	uint8_t count = 0;
+
+	// Only sprites that change can disturb the others
+	bool visible = sprite->flags & LCD_SPRITE_VISIBLE;
+	bool drawn = sprite->flags & LCD_SPRITE_DRAWN;
+	int16_t x = sprite->nextX + clip.originX, y = sprite->nextY + clip.originY;
+	if (visible == drawn && (!drawn || (sprite->x == x && sprite->y == y && !(sprite->flags & LCD_SPRITE_CHANGED))))
+		return false;
+
+	if (drawn)
+		rects[count++] = lcdSpriteRect(sprite, sprite->x, sprite->y);
+	if (visible)
+		rects[count++] = lcdSpriteRect(sprite, x, y);
+
+	for (uint8_t i = 0; i < _count; i++) {
+		const lcdSprite_t *other = &_sprites[i];
+		if (i == index)
+			continue;
+		for (uint8_t k = 0; k < count; k++) {
+			lcdRect_t rect;
+			if (other->flags & LCD_SPRITE_DRAWN) {
+				rect = lcdSpriteRect(other, other->x, other->y);
+				if (lcdRectOverlaps(&rects[k], &rect))
+					return true;
+			}
+			if (other->flags & LCD_SPRITE_VISIBLE) {
+				rect = lcdSpriteRect(other, other->nextX + clip.originX, other->nextY + clip.originY);
+				if (lcdRectOverlaps(&rects[k], &rect))
+					return true;
+			}
+		}
+	}
+	return false;
+}
+
+void ILI9341Sprites::moveSprite(lcdSprite_t *sprite, int16_t x, int16_t y) {
+	uint16_t width = sprite->image->width;
+	uint16_t height = sprite->image->height;
+	lcdRect_t before = lcdSpriteRect(sprite, sprite->x, sprite->y);
+	lcdRect_t after = lcdSpriteRect(sprite, x, y);
+	lcdRect_t parts[4];
+	uint8_t count;
+
+	if (!lcdRectOverlaps(&before, &after)) {
+		restore(sprite);
+		save(sprite, x, y);
+		return;
+	}
+
+	// Exposed part of old position gets its background back
+	count = lcdRectSubtract(&before, &after, parts);
+	for (uint8_t i = 0; i < count; i++) {
+		_display.writeClippedRect(parts[i].x0, parts[i].y0, parts[i].x1 - parts[i].x0 + 1, parts[i].y1 - parts[i].y0 + 1,
+				sprite->background + (parts[i].y0 - before.y0) * width + (parts[i].x0 - before.x0), width);
+	}
+
+	// Background of the overlap is kept, moved to the new place in the buffer
+	int16_t dx = x - sprite->x, dy = y - sprite->y;
+	uint16_t length = width - (dx < 0 ? -dx : dx);
+	uint16_t *target = sprite->background + (dx < 0 ? -dx : 0);
+	const uint16_t *source = sprite->background + (dx > 0 ? dx : 0);
+	if (dy >= 0) {
+		for (int16_t row = 0; row + dy < height; row++)
+			memmove(target + row * width, source + (row + dy) * width, length * sizeof(uint16_t));
+	} else {
+		for (int16_t row = height - 1; row + dy >= 0; row--)
+			memmove(target + row * width, source + (row + dy) * width, length * sizeof(uint16_t));
+	}
+
+	// Only the newly covered part is read
+	count = lcdRectSubtract(&after, &before, parts);
+	for (uint8_t i = 0; i < count; i++) {
+		_display.readClippedRect(parts[i].x0, parts[i].y0, parts[i].x1 - parts[i].x0 + 1, parts[i].y1 - parts[i].y0 + 1,
+				sprite->background + (parts[i].y0 - after.y0) * width + (parts[i].x0 - after.x0), width);
+	}
+
+	sprite->x = x;
+	sprite->y = y;
+}
+
+void ILI9341Sprites::restore(lcdSprite_t *sprite) {
+	_display.writeClippedRect(sprite->x, sprite->y, sprite->image->width, sprite->image->height,
+			sprite->background, sprite->image->width);
+	sprite->flags &= ~LCD_SPRITE_DRAWN;
+}
+
+void ILI9341Sprites::save(lcdSprite_t *sprite, int16_t x, int16_t y) {
+	_display.readClippedRect(x, y, sprite->image->width, sprite->image->height,
+			sprite->background, sprite->image->width);
+	sprite->x = x;
+	sprite->y = y;
+}
+
+void ILI9341Sprites::draw(lcdSprite_t *sprite) {
+	const sImage_t *image = sprite->image;
+	_display.writeClippedRect(sprite->x, sprite->y, image->width, image->height,
+			(const uint16_t*)image->pData, image->bytesPerLine / 2);
+	sprite->flags |= LCD_SPRITE_DRAWN;
+}
+
+/* --- Static functions --- */
+
+static lcdRect_t lcdMakeRect(int16_t x0, int16_t y0, int16_t x1, int16_t y1) {
+	lcdRect_t rect = { x0, y0, x1, y1 };
+	return rect;
+}
+
+static lcdRect_t lcdSpriteRect(const lcdSprite_t *sprite, int16_t x, int16_t y) {
+	return lcdMakeRect(x, y, x + sprite->image->width - 1, y + sprite->image->height - 1);
+}
+
+static bool lcdRectOverlaps(const lcdRect_t *a, const lcdRect_t *b) {
+	return a->x0 <= b->x1 && b->x0 <= a->x1 && a->y0 <= b->y1 && b->y0 <= a->y1;
+}
+
+static uint8_t lcdRectSubtract(const lcdRect_t *a, const lcdRect_t *b, lcdRect_t *parts) {
+	uint8_t count = 0;
+	int16_t top = (b->y0 > a->y0) ? b->y0 : a->y0;
+	int16_t bottom = (b->y1 < a->y1) ? b->y1 : a->y1;
+
+	// Full width bands above and below, then the sides of the rows in between
+	if (b->y0 > a->y0)
+		parts[count++] = lcdMakeRect(a->x0, a->y0, a->x1, b->y0 - 1);
+	if (b->y1 < a->y1)
+		parts[count++] = lcdMakeRect(a->x0, b->y1 + 1, a->x1, a->y1);
+	if (b->x0 > a->x0)
+		parts[count++] = lcdMakeRect(a->x0, top, b->x0 - 1, bottom);
+	if (b->x1 < a->x1)
+		parts[count++] = lcdMakeRect(b->x1 + 1, top, a->x1, bottom);
+	return count;
+}
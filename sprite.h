@@ -0,0 +1,140 @@
+/**  
+* @file sprite.h  
+* @brief Sprites over a ILI9341 display, each one saves the
+* background it covers and restores it when it moves
+*  
+* @author Marcelo H Moraes 
+* 
+* @date 10/18/2026
+*
+* Copyright (c) 2021, Marcelo H Moraes
+* SPDX-License-Identifier: Apache-2.0
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+*
+* You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied.
+*
+* See the License for the specific language governing permissions and limitations under the License.
+*/ 
+
+#ifndef _SPRITE_H_
+#define _SPRITE_H_
+
+#include "ili9341.h"
+
+#ifndef LCD_SPRITE_MAX
+#define LCD_SPRITE_MAX		32
+#endif
+
+#define LCD_SPRITE_VISIBLE	0x01    // Shown after next update
+#define LCD_SPRITE_DRAWN	0x02    // In screen now
+#define LCD_SPRITE_CHANGED	0x04    // Image changed since last update
+
+/**
+ * @brief  One sprite of the layer
+ */
+typedef struct {
+	const sImage_t *image;
+	uint16_t *background;   // Screen under the sprite, width * height pixels
+	int16_t x;              // Screen position drawn
+	int16_t y;
+	int16_t nextX;          // Position after next update, in display coordinates
+	int16_t nextY;
+	uint8_t flags;
+} lcdSprite_t;
+
+/**
+ * @brief Layer of sprites over what is drawn in the display.
+ *        Changes are applied by update: a sprite that moves restores only
+ *        the part of the old position that is exposed, keeps the rest of
+ *        its saved background and reads only the newly covered part.
+ *        Sprites that overlap each other are redrawn in order.
+ *
+ * @code
+ * static uint16_t cursorBackground[16 * 16];
+ * ILI9341Sprites sprites(display);
+ * int8_t cursor = sprites.add(&bmCursor, cursorBackground, 10, 10);
+ * sprites.moveTo(cursor, x, y);
+ * sprites.update();
+ * @endcode
+ */
+class ILI9341Sprites {
+protected:
+
+	ILI9341 &_display;
+	lcdSprite_t _sprites[LCD_SPRITE_MAX];
+	uint8_t _count = 0;
+
+	bool overlapsOthers(uint8_t index);
+	void moveSprite(lcdSprite_t *sprite, int16_t x, int16_t y);
+	void restore(lcdSprite_t *sprite);
+	void save(lcdSprite_t *sprite, int16_t x, int16_t y);
+	void draw(lcdSprite_t *sprite);
+
+public:
+
+	/**
+	 * @brief Create an empty layer over the display
+	 *
+	 * @param display	Display where the sprites are drawn
+	 */
+	ILI9341Sprites(ILI9341 &display);
+
+	/**
+	 * @brief Add a sprite on top of the others, drawn in next update
+	 *
+	 * @param image			16 bits image of the sprite
+	 * @param background	Buffer with width * height pixels, owned by the caller
+	 * @param x				x-coordinate
+	 * @param y				y-coordinate
+	 * @param visible		Show the sprite
+	 *
+	 * @return int8_t		Index of sprite, -1 if the layer is full
+	 */
+	int8_t add(const sImage_t *image, uint16_t *background, int16_t x = 0, int16_t y = 0, bool visible = true);
+
+	/**
+	 * @brief Set the position of a sprite for next update
+	 *
+	 * @return void
+	 */
+	void moveTo(uint8_t sprite, int16_t x, int16_t y);
+
+	/**
+	 * @brief Show or hide a sprite in next update
+	 *
+	 * @return void
+	 */
+	void setVisible(uint8_t sprite, bool visible);
+
+	/**
+	 * @brief Change the image of a sprite, for animations.
+	 *        The size must be the same as the first image.
+	 *
+	 * @return void
+	 */
+	void setImage(uint8_t sprite, const sImage_t *image);
+
+	/**
+	 * @brief Restore the background of all sprites, to draw under them.
+	 *        They are drawn again in next update.
+	 *
+	 * @return void
+	 */
+	void hideAll(void);
+
+	/**
+	 * @brief Apply the changes to the display
+	 *
+	 * @return uint8_t	Number of sprites drawn
+	 */
+	uint8_t update(void);
+
+};
+
+#endif  /* _SPRITE_H_ */
@@ -0,0 +1,146 @@
+/**  
+* @file stripchart.cpp  
+* @brief Strip chart over a ILI9341 display in landscape,
+* moved by the vertical scroll of the controller
+*  
+* @author Marcelo H Moraes 
+* 
+* @date 10/18/2026
+*
+* Copyright (c) 2021, Marcelo H Moraes
+* SPDX-License-Identifier: Apache-2.0
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+*
+* You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied.
+*
+* See the License for the specific language governing permissions and limitations under the License.
+*/ 
+
+#include "stripchart.h"
+
+/* --- Public methods --- */
+
+ILI9341StripChart::ILI9341StripChart(ILI9341 &display, int16_t x, uint16_t width)
+		: _display(display), _x(x), _width(width) {
+}
+
+void ILI9341StripChart::setColors(uint16_t color, uint16_t bg, uint16_t grid) {
+	_color = color;
+	_bg = bg;
+	_grid = grid;
+}
+
+void ILI9341StripChart::setGrid(uint16_t rows, uint16_t columns) {
+	_gridRows = rows;
+	_gridColumns = columns;
+}
+
+void ILI9341StripChart::setRange(int16_t bottom, int16_t top) {
+	if (bottom == top)
+		return;
+	_bottom = bottom;
+	_top = top;
+}
+
+bool ILI9341StripChart::begin(void) {
+	LCD_LOCK(_display);
+	const lcdProperties_t &properties = _display.Properties;
+
+	if (properties.orientation != LCD_ORIENTATION_LANDSCAPE
+			&& properties.orientation != LCD_ORIENTATION_LANDSCAPE_MIRROR)
+		return false;
+	if (_x < 0 || _width == 0 || _x + _width > properties.width)
+		return false;
+
+	// Screen columns are panel lines, counted from the right in the mirror orientation
+	_mirror = properties.orientation == LCD_ORIENTATION_LANDSCAPE_MIRROR;
+	_topFixed = _mirror ? ILI9341_PIXEL_HEIGHT - _x - _width : _x;
+	_line = _topFixed;
+	_display.setScrollArea(_topFixed, ILI9341_PIXEL_HEIGHT - _topFixed - _width);
+	_display.setScrollStart(_line);
+
+	// Nothing scrolled yet, memory and screen columns are the same
+	for (uint16_t i = 0; i < _width; i++)
+		writeColumn(_x + i, i, -1, -2);
+	_samples = _gridColumns ? _width % _gridColumns : 0;
+	_row = -1;
+	_started = true;
+	return true;
+}
+
+void ILI9341StripChart::add(int16_t sample) {
+	LCD_LOCK(_display);
+	int16_t row = sampleRow(sample);
+	int16_t previous = (_row < 0) ? row : _row;
+	int16_t row0 = row, row1 = row;
+	uint16_t line;
+
+	if (!_started)
+		return;
+
+	// Joined to the last sample, without its row
+	if (row > previous)
+		row0 = previous + 1;
+	else if (row < previous)
+		row1 = previous - 1;
+
+	// The line that leaves the screen at the left comes back at the right
+	if (_mirror) {
+		_line = (_line == _topFixed) ? _topFixed + _width - 1 : _line - 1;
+		line = _line;
+	} else {
+		line = _line;
+		_line = (_line + 1 == _topFixed + _width) ? _topFixed : _line + 1;
+	}
+
+	writeColumn(_mirror ? ILI9341_PIXEL_HEIGHT - 1 - line : line, _samples, row0, row1);
+	if (++_samples == _gridColumns)
+		_samples = 0;
+	_display.setScrollStart(_line);
+	_row = row;
+}
+
+void ILI9341StripChart::end(void) {
+	LCD_LOCK(_display);
+	if (!_started)
+		return;
+	_display.setScrollArea(0, 0);
+	_display.setScrollStart(0);
+	_display.setWindow(_x, 0, _x + _width - 1, _display.Properties.height - 1);
+	_display.writeColor(_bg, (uint32_t)_width * _display.Properties.height);
+	_started = false;
+}
+
+/* --- Protected methods --- */
+
+int16_t ILI9341StripChart::sampleRow(int16_t sample) {
+	int16_t height = _display.Properties.height;
+	int32_t row = (int32_t)(sample - _bottom) * (height - 1) / (_top - _bottom);
+	if (row < 0)
+		row = 0;
+	if (row > height - 1)
+		row = height - 1;
+	return height - 1 - row;
+}
+
+void ILI9341StripChart::writeColumn(int16_t x, uint16_t sample, int16_t row0, int16_t row1) {
+	int16_t height = _display.Properties.height;
+	bool gridColumn = _gridColumns && (sample % _gridColumns) == 0;
+
+	// The whole column in one window, grid and trace in the same stream
+	_display.setWindow(x, 0, x, height - 1);
+	for (int16_t row = 0; row < height; row++) {
+		if (row >= row0 && row <= row1)
+			_display.writeData(_color);
+		else if (gridColumn || (_gridRows && (height - 1 - row) % _gridRows == 0))
+			_display.writeData(_grid);
+		else
+			_display.writeData(_bg);
+	}
+}
@@ -0,0 +1,134 @@
+/**  
+* @file stripchart.h  
+* @brief Strip chart over a ILI9341 display in landscape,
+* moved by the vertical scroll of the controller
+*  
+* @author Marcelo H Moraes 
+* 
+* @date 10/18/2026
+*
+* Copyright (c) 2021, Marcelo H Moraes
+* SPDX-License-Identifier: Apache-2.0
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+*
+* You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied.
+*
+* See the License for the specific language governing permissions and limitations under the License.
+*/ 
+
+#ifndef _STRIPCHART_H_
+#define _STRIPCHART_H_
+
+#include "ili9341.h"
+
+/**
+ * @brief Time series chart that moves to the left one column per sample.
+ *        The controller scrolls along the long axis of the panel, so in
+ *        landscape the chart columns are the scroll area and each sample
+ *        writes only the new column. The columns left and right of the
+ *        chart are fixed, to keep labels and scales.
+ *        While the chart runs, the driver must not draw in its columns.
+ *
+ * @code
+ * ILI9341StripChart chart(display, 40, 280);
+ * chart.setRange(0, 4095);
+ * chart.setGrid(40, 40);
+ * chart.begin();
+ * display.drawString(0, 0, "4095");
+ * chart.add(adc.read_u16() >> 4);
+ * @endcode
+ */
+class ILI9341StripChart {
+protected:
+
+	ILI9341 &_display;
+	int16_t _x;
+	uint16_t _width;
+	uint16_t _topFixed = 0;     // Panel lines before the scroll area
+	uint16_t _line = 0;         // Memory line shown first in the scroll area
+	uint16_t _samples = 0;      // Samples since the last vertical grid line
+	int16_t _row = -1;          // Row of the last sample, -1 before the first
+	uint16_t _color = GREEN;
+	uint16_t _bg = BLACK;
+	uint16_t _grid = GRAY_50;
+	uint16_t _gridRows = 0;
+	uint16_t _gridColumns = 0;
+	int16_t _bottom = 0;
+	int16_t _top = ILI9341_PIXEL_WIDTH - 1;
+	bool _mirror = false;
+	bool _started = false;
+
+	int16_t sampleRow(int16_t sample);
+	void writeColumn(int16_t x, uint16_t sample, int16_t row0, int16_t row1);
+
+public:
+
+	/**
+	 * @brief Create a chart in some columns of the screen, with the full height
+	 *
+	 * @param display	Display where the chart is drawn
+	 * @param x			First column, in screen coordinates
+	 * @param width		Number of columns, one for each sample shown
+	 */
+	ILI9341StripChart(ILI9341 &display, int16_t x, uint16_t width);
+
+	/**
+	 * @brief Set the colors, used from the next begin
+	 *
+	 * @param color		Trace color
+	 * @param bg		Background color
+	 * @param grid		Grid color
+	 *
+	 * @return void
+	 */
+	void setColors(uint16_t color, uint16_t bg, uint16_t grid);
+
+	/**
+	 * @brief Set the grid, used from the next begin
+	 *
+	 * @param rows		Pixels between horizontal lines, from the bottom. 0 for none
+	 * @param columns	Samples between vertical lines, they move with the samples. 0 for none
+	 *
+	 * @return void
+	 */
+	void setGrid(uint16_t rows, uint16_t columns);
+
+	/**
+	 * @brief Set the sample values at the bottom and top rows of the chart.
+	 *        Samples out of range are drawn at the border
+	 *
+	 * @return void
+	 */
+	void setRange(int16_t bottom, int16_t top);
+
+	/**
+	 * @brief Set the scroll area and draw the empty chart
+	 *
+	 * @return bool		false if the display is not in landscape or the chart is out of the screen
+	 */
+	bool begin(void);
+
+	/**
+	 * @brief Move the chart one column to the left and draw the sample
+	 *        in the new column at the right
+	 *
+	 * @return void
+	 */
+	void add(int16_t sample);
+
+	/**
+	 * @brief Stop the scroll and clear the chart columns
+	 *
+	 * @return void
+	 */
+	void end(void);
+
+};
+
+#endif  /* _STRIPCHART_H_ */
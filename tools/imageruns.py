@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+"""
+Find the opaque runs of a 16 bits image for ILI9341::drawImage with sImageRuns_t.
+
+Reads an image source file in the format of the bitmap converter (a
+uint16_t array and a sImage_t) and prints the runs as C source, to be
+added to the same file:
+
+    imageruns.py STLogo.cpp 0xFFFF >> STLogo.cpp
+
+Copyright (c) 2021, Marcelo H Moraes
+SPDX-License-Identifier: Apache-2.0
+"""
+
+import argparse
+import re
+import sys
+
+
+def parse(source):
+    array = re.search(r"static\s+const\s+uint16_t\s+(\w+)\[\]\s*=\s*\{(.*?)\};", source, re.S)
+    image = re.search(r"const\s+sImage_t\s+(\w+)\s*=\s*\{\s*(\d+)\s*,[^,]*?(\d+)\s*,", source, re.S)
+    if not array or not image:
+        sys.exit("no uint16_t array and sImage_t found")
+    pixels = [int(value, 0) for value in re.findall(r"0x[0-9A-Fa-f]+|\d+", array.group(2))]
+    return image.group(1), int(image.group(2)), int(image.group(3)), pixels
+
+
+def runs(width, height, pixels, key):
+    words = []
+    for row in range(height):
+        line = pixels[row * width:(row + 1) * width]
+        found = []
+        px = 0
+        while px < width:
+            while px < width and line[px] == key:
+                px += 1
+            start = px
+            while px < width and line[px] != key:
+                px += 1
+            if px > start:
+                found += [start, px - start]
+        words.append([len(found) // 2] + found)
+    return words
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[1])
+    parser.add_argument("source", help="image source file")
+    parser.add_argument("key", help="transparent color, RGB565")
+    args = parser.parse_args()
+
+    with open(args.source) as f:
+        name, width, height, pixels = parse(f.read())
+    rows = runs(width, height, pixels, int(args.key, 0))
+
+    print()
+    print("static const uint16_t _ac%sRuns[] = {" % name[2:])
+    for row in rows:
+        print("  " + ", ".join(str(word) for word in row) + ",")
+    print("};")
+    print()
+    print("const sImageRuns_t %sRuns = {" % name)
+    print("  &%s," % name)
+    print("  _ac%sRuns" % name[2:])
+    print("};")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+"""
+Decode a screen capture of ILI9341::captureScreen into a PNG.
+
+The capture is read from a file, or from a serial port when --baud is given:
+
+    lcdshot.py capture.bin screen.png
+    lcdshot.py --baud 115200 /dev/ttyACM0 screen.png
+
+Copyright (c) 2021, Marcelo H Moraes
+SPDX-License-Identifier: Apache-2.0
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+
+def read_exact(stream, count):
+    data = b""
+    while len(data) < count:
+        chunk = stream.read(count - len(data))
+        if not chunk:
+            sys.exit("capture ended early")
+        data += chunk
+    return data
+
+
+def find_header(stream):
+    # Skip anything sent before the capture, like log messages
+    window = b""
+    while window != b"LCDS":
+        window = (window + read_exact(stream, 1))[-4:]
+    return struct.unpack("<HH", read_exact(stream, 4))
+
+
+def decode(stream):
+    width, height = find_header(stream)
+    pixels = []
+    while len(pixels) < width * height:
+        n = read_exact(stream, 1)[0]
+        if n < 128:
+            data = read_exact(stream, 2 * (n + 1))
+            pixels.extend(struct.unpack("<%dH" % (n + 1), data))
+        else:
+            pixels.extend(struct.unpack("<H", read_exact(stream, 2)) * (n - 127))
+    return width, height, pixels
+
+
+def rgb888(pixel):
+    r = (pixel >> 11) & 0x1F
+    g = (pixel >> 5) & 0x3F
+    b = pixel & 0x1F
+    return bytes(((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)))
+
+
+def write_png(path, width, height, pixels):
+    def chunk(kind, data):
+        return (struct.pack(">I", len(data)) + kind + data
+                + struct.pack(">I", zlib.crc32(kind + data) & 0xFFFFFFFF))
+
+    rows = bytearray()
+    for y in range(height):
+        rows.append(0)
+        for pixel in pixels[y * width:(y + 1) * width]:
+            rows += rgb888(pixel)
+
+    with open(path, "wb") as png:
+        png.write(b"\x89PNG\r\n\x1a\n")
+        png.write(chunk(b"IHDR", struct.pack(">IIBBBBB", width, height, 8, 2, 0, 0, 0)))
+        png.write(chunk(b"IDAT", zlib.compress(bytes(rows), 9)))
+        png.write(chunk(b"IEND", b""))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[1])
+    parser.add_argument("source", help="capture file, or serial port with --baud")
+    parser.add_argument("output", help="PNG file to write")
+    parser.add_argument("--baud", type=int, help="read from a serial port at this baud rate")
+    args = parser.parse_args()
+
+    if args.baud:
+        import serial
+        stream = serial.Serial(args.source, args.baud)
+    else:
+        stream = open(args.source, "rb")
+
+    with stream:
+        width, height, pixels = decode(stream)
+    write_png(args.output, width, height, pixels)
+    print("%s: %dx%d" % (args.output, width, height))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,145 @@
+/**  
+* @file trace.cpp  
+* @brief Waveform trace over a ILI9341 display, updated column
+* by column from the samples drawn before
+*  
+* @author Marcelo H Moraes 
+* 
+* @date 10/18/2026
+*
+* Copyright (c) 2021, Marcelo H Moraes
+* SPDX-License-Identifier: Apache-2.0
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+*
+* You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied.
+*
+* See the License for the specific language governing permissions and limitations under the License.
+*/ 
+
+#include "trace.h"
+
+/* --- Static functions prototypes --- */
+
+/*!
+ * @brief  Rows of a column, from the row of the column before to its own row.
+ *         The row before is left out so the trace is one pixel thick
+ */
+static void lcdTraceSpan(int16_t previous, int16_t row, int16_t *row0, int16_t *row1);
+
+/* --- Public methods --- */
+
+ILI9341Trace::ILI9341Trace(ILI9341 &display, int16_t x, int16_t y, uint16_t width, uint16_t height, int16_t *rows)
+		: _display(display), _rows(rows), _x(x), _y(y), _width(width), _height(height), _top(height - 1) {
+}
+
+void ILI9341Trace::setColors(uint16_t color, uint16_t bg) {
+	_color = color;
+	_bg = bg;
+	_drawn = false;
+}
+
+void ILI9341Trace::setBackground(const sImage_t *image) {
+	_background = image;
+	_drawn = false;
+}
+
+void ILI9341Trace::setRange(int16_t bottom, int16_t top) {
+	if (bottom == top)
+		return;
+	_bottom = bottom;
+	_top = top;
+}
+
+void ILI9341Trace::invalidate(void) {
+	_drawn = false;
+}
+
+void ILI9341Trace::update(const int16_t *samples) {
+	LCD_LOCK(_display);
+	const lcdClip_t &clip = _display.Clip;
+	int16_t x = _x + clip.originX;
+	int16_t y = _y + clip.originY;
+	int16_t previous = 0, oldPrevious = 0;
+
+	// First update, the whole plot is cleared
+	if (!_drawn && _background == NULL) {
+		_display.fillWindow(x, y, x + _width - 1, y + _height - 1, _bg);
+	} else if (!_drawn) {
+		_display.writeClippedRect(x, y, _width, _height,
+				(const uint16_t*)_background->pData, _background->bytesPerLine / 2);
+	}
+
+	for (uint16_t column = 0; column < _width; column++) {
+		int16_t row = sampleRow(samples[column]);
+		int16_t new0, new1, old0, old1;
+
+		lcdTraceSpan(column ? previous : row, row, &new0, &new1);
+		if (_drawn) {
+			lcdTraceSpan(column ? oldPrevious : _rows[column], _rows[column], &old0, &old1);
+		} else {
+			// Nothing drawn, the old span is empty
+			old0 = _height;
+			old1 = _height - 1;
+		}
+
+		// Old rows out of the new span are erased, new rows out of the old span are drawn
+		erase(x, y, column, old0, (old1 < new0 - 1) ? old1 : new0 - 1);
+		erase(x, y, column, (old0 > new1 + 1) ? old0 : new1 + 1, old1);
+		if (old0 > old1) {
+			_display.fillWindow(x + column, y + new0, x + column, y + new1, _color);
+		} else {
+			if (new0 < old0)
+				_display.fillWindow(x + column, y + new0, x + column, y + ((new1 < old0 - 1) ? new1 : old0 - 1), _color);
+			if (new1 > old1)
+				_display.fillWindow(x + column, y + ((new0 > old1 + 1) ? new0 : old1 + 1), x + column, y + new1, _color);
+		}
+
+		oldPrevious = _rows[column];
+		_rows[column] = row;
+		previous = row;
+	}
+	_drawn = true;
+}
+
+/* --- Protected methods --- */
+
+int16_t ILI9341Trace::sampleRow(int16_t sample) {
+	int32_t row = (int32_t)(sample - _bottom) * (_height - 1) / (_top - _bottom);
+	if (row < 0)
+		row = 0;
+	if (row > _height - 1)
+		row = _height - 1;
+	return _height - 1 - row;
+}
+
+void ILI9341Trace::erase(int16_t x, int16_t y, int16_t column, int16_t row0, int16_t row1) {
+	if (row0 > row1)
+		return;
+	if (_background == NULL) {
+		_display.fillWindow(x + column, y + row0, x + column, y + row1, _bg);
+		return;
+	}
+	uint16_t stride = _background->bytesPerLine / 2;
+	_display.writeClippedRect(x + column, y + row0, 1, row1 - row0 + 1,
+			(const uint16_t*)_background->pData + row0 * stride + column, stride);
+}
+
+/* --- Static functions --- */
+
+static void lcdTraceSpan(int16_t previous, int16_t row, int16_t *row0, int16_t *row1) {
+	if (row > previous) {
+		*row0 = previous + 1;
+		*row1 = row;
+	} else if (row < previous) {
+		*row0 = row;
+		*row1 = previous - 1;
+	} else {
+		*row0 = *row1 = row;
+	}
+}
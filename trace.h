@@ -0,0 +1,122 @@
+/**  
+* @file trace.h  
+* @brief Waveform trace over a ILI9341 display, updated column
+* by column from the samples drawn before
+*  
+* @author Marcelo H Moraes 
+* 
+* @date 10/18/2026
+*
+* Copyright (c) 2021, Marcelo H Moraes
+* SPDX-License-Identifier: Apache-2.0
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+*
+* You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied.
+*
+* See the License for the specific language governing permissions and limitations under the License.
+*/ 
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include "ili9341.h"
+
+/**
+ * @brief Oscilloscope like trace of one sample per column.
+ *        The row of each column is kept, so an update erases only the
+ *        part of the old vertical span of a column that the new one does
+ *        not cover and draws only the new part. Columns are joined by
+ *        vertical spans and the trace stays continuous.
+ *
+ * @code
+ * static int16_t traceRows[240];
+ * ILI9341Trace trace(display, 0, 100, 240, 120, traceRows);
+ * trace.setRange(0, 4095);
+ * trace.update(adcSamples);
+ * @endcode
+ */
+class ILI9341Trace {
+protected:
+
+	ILI9341 &_display;
+	int16_t *_rows;             // Row drawn in each column, from the top of the plot
+	const sImage_t *_background = NULL;
+	int16_t _x;
+	int16_t _y;
+	uint16_t _width;
+	uint16_t _height;
+	uint16_t _color = GREEN;
+	uint16_t _bg = BLACK;
+	int16_t _bottom = 0;
+	int16_t _top;
+	bool _drawn = false;
+
+	int16_t sampleRow(int16_t sample);
+	void erase(int16_t x, int16_t y, int16_t column, int16_t row0, int16_t row1);
+
+public:
+
+	/**
+	 * @brief Create a trace in a rectangle of the display
+	 *
+	 * @param display	Display where the trace is drawn
+	 * @param x			x-coordinate of the plot
+	 * @param y			y-coordinate of the plot
+	 * @param width		Width of the plot, one sample per column
+	 * @param height	Height of the plot
+	 * @param rows		Buffer with width values, owned by the caller
+	 */
+	ILI9341Trace(ILI9341 &display, int16_t x, int16_t y, uint16_t width, uint16_t height, int16_t *rows);
+
+	/**
+	 * @brief Set the colors, used from the next full redraw
+	 *
+	 * @param color		Trace color
+	 * @param bg		Plot background, used when there is no background image
+	 *
+	 * @return void
+	 */
+	void setColors(uint16_t color, uint16_t bg);
+
+	/**
+	 * @brief Set an image with the size of the plot, as a grid, to restore
+	 *        the pixels the trace leaves. NULL uses the background color
+	 *
+	 * @return void
+	 */
+	void setBackground(const sImage_t *image);
+
+	/**
+	 * @brief Set the sample values at the bottom and top rows of the plot.
+	 *        Samples out of range are drawn at the border
+	 *
+	 * @return void
+	 */
+	void setRange(int16_t bottom, int16_t top);
+
+	/**
+	 * @brief Clear the plot and draw the whole trace in next update,
+	 *        after something else was drawn over it
+	 *
+	 * @return void
+	 */
+	void invalidate(void);
+
+	/**
+	 * @brief Draw a new set of samples
+	 *
+	 * @param samples	One sample for each column of the plot
+	 *
+	 * @return void
+	 */
+	void update(const int16_t *samples);
+
+};
+
+#endif  /* _TRACE_H_ */